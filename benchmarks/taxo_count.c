@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+/* times the post-processing of a loaded taxonomy (preorder numbering and subtree counts,
+   raa_sp_count_taxa) on synthetic trees
+   usage: taxo_count [taxa [runs]], 3000000 taxa and 5 runs by default
+ */
+
+#include <Bpp/Raa/RAA_acnuc.h>
+#include <time.h>
+
+static unsigned long seed = 12345;
+
+static int next_random(int n)
+/* a random number in 0..n-1 that is the same on all platforms */
+{
+  seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return (int)((seed >> 4) % (unsigned long)n);
+}
+
+
+static raa_sp_tree* make_tree(int n, int deep)
+/* a tree of n taxa, of ranks 2 to n + 1, rooted at rank 2;
+   deep: a single lineage, otherwise each taxon hangs from a random earlier one
+ */
+{
+  raa_sp_tree* tree;
+  int *last_child, i, parent;
+
+  tree = (raa_sp_tree*)calloc(1, sizeof(raa_sp_tree));
+  last_child = (int*)calloc(n + 2, sizeof(int));
+  if (tree == NULL || last_child == NULL)
+    return NULL;
+  tree->max_sp = n + 1;
+  tree->parent = (int*)calloc(n + 2, sizeof(int));
+  tree->first_child = (int*)calloc(n + 2, sizeof(int));
+  tree->next_sibling = (int*)calloc(n + 2, sizeof(int));
+  tree->count = (int*)calloc(n + 2, sizeof(int));
+  tree->preorder = (int*)calloc(n + 2, sizeof(int));
+  tree->preorder_end = (int*)calloc(n + 2, sizeof(int));
+  if (tree->parent == NULL || tree->first_child == NULL || tree->next_sibling == NULL ||
+      tree->count == NULL || tree->preorder == NULL || tree->preorder_end == NULL)
+    return NULL;
+  for (i = 3; i <= n + 1; i++)
+  {
+    parent = deep ? i - 1 : 2 + next_random(i - 2);
+    tree->parent[i] = parent;
+    if (last_child[parent] == 0)
+      tree->first_child[parent] = i;
+    else
+      tree->next_sibling[last_child[parent]] = i;
+    last_child[parent] = i;
+  }
+  free(last_child);
+  return tree;
+}
+
+
+static void free_tree(raa_sp_tree* tree)
+{
+  free(tree->parent);
+  free(tree->first_child);
+  free(tree->next_sibling);
+  free(tree->count);
+  free(tree->preorder);
+  free(tree->preorder_end);
+  free(tree);
+}
+
+
+static int run(const char* label, raa_sp_tree* tree, int runs)
+/* times raa_sp_count_taxa on tree, keeping the best of runs; returns 0 if the counts are right */
+{
+  int i, r, *seqs;
+  long total;
+  clock_t start;
+  double t, best = -1;
+
+  seqs = (int*)malloc((tree->max_sp + 1) * sizeof(int));
+  if (seqs == NULL)
+    return 1;
+  for (i = 2, total = 0; i <= tree->max_sp; i++)
+  {
+    seqs[i] = next_random(5);
+    total += seqs[i];
+  }
+  for (r = 0; r < runs; r++)
+  {
+    memcpy(tree->count + 2, seqs + 2, (tree->max_sp - 1) * sizeof(int));
+    start = clock();
+    if (raa_sp_count_taxa(tree) != 0)
+      return 1;
+    t = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (best < 0 || t < best)
+      best = t;
+  }
+  free(seqs);
+  printf("%-8s %d taxa: %.3f s (best of %d)\n", label, tree->max_sp - 1, best, runs);
+  if (tree->count[2] != total || tree->preorder_end[2] != tree->max_sp - 1)
+  {
+    fprintf(stderr, "%s: wrong counts\n", label);
+    return 1;
+  }
+  return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+  int n = 3000000, runs = 5, deep, err = 0;
+  raa_sp_tree* tree;
+
+  if (argc > 1)
+    n = atoi(argv[1]);
+  if (argc > 2)
+    runs = atoi(argv[2]);
+  if (n < 1 || runs < 1)
+  {
+    fprintf(stderr, "usage: %s [taxa [runs]]\n", argv[0]);
+    return 1;
+  }
+  for (deep = 0; deep <= 1; deep++)
+  {
+    tree = make_tree(n, deep);
+    if (tree == NULL)
+    {
+      fprintf(stderr, "not enough memory\n");
+      return 1;
+    }
+    err |= run(deep ? "lineage" : "random", tree, runs);
+    free_tree(tree);
+  }
+  return err;
+}
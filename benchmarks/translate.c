@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+/* times bulk codon translation (translate_nucleotides) against codon by codon translation (codaa)
+   on random nucleotides
+   usage: translate [codons [runs]], 10000000 codons and 5 runs by default
+ */
+
+#include <Bpp/Raa/RAA_acnuc.h>
+#include <time.h>
+
+char codaa(char* codon, int code);
+
+
+int main(int argc, char** argv)
+{
+  int runs = 5, r, gc;
+  size_t n = 10000000, i;
+  char *nt, *by_codon, *bulk;
+  unsigned long seed = 12345;
+  clock_t start;
+  double t, best_codon, best_bulk;
+
+  if (argc > 1)
+    n = (size_t)atol(argv[1]);
+  if (argc > 2)
+    runs = atoi(argv[2]);
+  if (n < 1 || runs < 1)
+  {
+    fprintf(stderr, "usage: %s [codons [runs]]\n", argv[0]);
+    return 1;
+  }
+  nt = (char*)malloc(3 * n);
+  by_codon = (char*)malloc(n);
+  bulk = (char*)malloc(n);
+  if (nt == NULL || by_codon == NULL || bulk == NULL)
+  {
+    fprintf(stderr, "not enough memory\n");
+    return 1;
+  }
+  for (i = 0; i < 3 * n; i++)
+  { /* mostly ACGT, a few lower-case or unknown bases */
+    seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+    nt[i] = "ACGTACGTACGTACGTacgtuN"[(seed >> 4) % 22];
+  }
+  for (gc = 0; gc <= 1; gc++)
+  {
+    best_codon = best_bulk = -1;
+    for (r = 0; r < runs; r++)
+    {
+      start = clock();
+      for (i = 0; i < n; i++)
+        by_codon[i] = codaa(nt + 3 * i, gc);
+      t = (double)(clock() - start) / CLOCKS_PER_SEC;
+      if (best_codon < 0 || t < best_codon)
+        best_codon = t;
+      start = clock();
+      translate_nucleotides(nt, 3 * n, gc, bulk);
+      t = (double)(clock() - start) / CLOCKS_PER_SEC;
+      if (best_bulk < 0 || t < best_bulk)
+        best_bulk = t;
+    }
+    printf("code %d, %lu codons: codaa %.3f s, translate_nucleotides %.3f s (best of %d)\n",
+        gc, (unsigned long)n, best_codon, best_bulk, runs);
+    if (memcmp(by_codon, bulk, n) != 0)
+    {
+      fprintf(stderr, "code %d: translations differ\n", gc);
+      return 1;
+    }
+  }
+  free(nt);
+  free(by_codon);
+  free(bulk);
+  return 0;
+}
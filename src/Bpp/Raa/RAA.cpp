@@ -11,6 +11,9 @@
 
 #include "RAA.h"
 
+#include <algorithm>
+#include <unordered_set>
+
 extern "C" {
 int get_ncbi_gc_number(int gc);
 int sock_printf(raa_db_access* raa_current_db, const char* fmt, ...);
@@ -70,17 +73,21 @@ unique_ptr<Sequence> RAA::getSeq_both(const string& name_or_accno, int rank, int
     return NULL;
   raa_gfrag(this->raa_data, rank, 1, length, (char*)cseq->data());
   cseq->resize(length);
-  shared_ptr<const Alphabet> alphab;
-  if (raa_data->swissprot || raa_data->nbrf)
-    alphab = AlphabetTools::PROTEIN_ALPHABET;
-  else
-    alphab = AlphabetTools::DNA_ALPHABET;
-  auto seq = make_unique<Sequence>(sname, *cseq, comment, alphab);
+  auto seq = make_unique<Sequence>(sname, *cseq, comment, getAlphabet());
   delete cseq;
   return seq;
 }
 
 
+shared_ptr<const Alphabet> RAA::getAlphabet()
+{
+  if (raa_data->swissprot || raa_data->nbrf)
+    return AlphabetTools::PROTEIN_ALPHABET;
+  else
+    return AlphabetTools::DNA_ALPHABET;
+}
+
+
 unique_ptr<Sequence> RAA::getSeq(const string& name_or_accno, int maxlength)
 {
   return getSeq_both(name_or_accno, 0, maxlength);
@@ -95,6 +102,202 @@ unique_ptr<Sequence> RAA::getSeq(int seqrank, int maxlength)
 }
 
 
+unique_ptr<VectorSequenceContainer> RAA::getSeqs(const vector<int>& seqranks, int maxlength, unsigned int window)
+{
+  vector<int> distinct;
+  unordered_set<int> seen;
+  for (auto seqrank : seqranks)
+  {
+    if (seen.insert(seqrank).second)
+      distinct.push_back(seqrank);
+  }
+  vector<unique_ptr<Sequence> > seqs;
+  getSeqs_pipelined(distinct, maxlength, window, seqs);
+  auto container = make_unique<VectorSequenceContainer>(getAlphabet());
+  for (auto& seq : seqs)
+  {
+    if (seq)
+      container->addSequence(seq->getName(), seq);
+  }
+  return container;
+}
+
+
+int RAA::streamSeq(int seqrank, const function<void(const char*, size_t)>& sink, int chunksize)
+{
+  int length, l, next, total, outstanding;
+  char* data;
+
+  if (seqrank < 2 || seqrank > raa_data->nseq || chunksize <= 0)
+    return 0;
+  if (raa_seqrank_attributes(raa_data, seqrank, &length, NULL, NULL, NULL, NULL, NULL, NULL) == NULL)
+    return 0;
+  next = 1;
+  total = outstanding = 0;
+  try
+  {
+    while (total < length)
+    {
+      // keep two requests in flight: the server prepares a chunk while the previous one is processed
+      while (outstanding < 2 && next <= length)
+      {
+        raa_gfrag_send(raa_data, seqrank, next, chunksize);
+        next += chunksize;
+        outstanding++;
+      }
+      data = raa_gfrag_receive_view(raa_data, &l);
+      outstanding--;
+      // replies to requests still in flight are read below
+      if (data == NULL || l == 0)
+        break;
+      sink(data, l);
+      total += l;
+    }
+  }
+  catch (...)
+  {
+    while (outstanding-- > 0)
+    {
+      raa_gfrag_receive_view(raa_data, &l);
+    }
+    throw;
+  }
+  while (outstanding-- > 0)
+  {
+    raa_gfrag_receive_view(raa_data, &l);
+  }
+  return total;
+}
+
+
+int RAA::streamSeq(int seqrank, ostream& out, int chunksize)
+{
+  return streamSeq(seqrank, [&out](const char* data, size_t l) { out.write(data, l); }, chunksize);
+}
+
+
+static void export_line(const char* line, size_t l, void* arg)
+{
+  ostream* out = (ostream*)arg;
+  out->write(line, l);
+  out->put('\n');
+}
+
+
+int RAA::exportList(RaaList& list, ostream& out, const string& format, const string& operation,
+    const string& feature, const string& bounds, const string& minbounds)
+{
+  char* message;
+  int count;
+
+  if (list.getType() != RaaList::LIST_SEQUENCES)
+    throw string("List must contain sequences");
+  void* opaque = raa_prep_extract(raa_data, (char*)format.c_str(), NULL, (char*)operation.c_str(),
+      (char*)feature.c_str(), (char*)bounds.c_str(), minbounds.empty() ? NULL : (char*)minbounds.c_str(),
+      &message, list.getRank());
+  if (opaque == NULL)
+  {
+    string error = (message == NULL ? "Sequence extraction failed" : message);
+    if (message != NULL)
+      free(message);
+    throw error;
+  }
+  raa_extract_set_sink(opaque, export_line, &out);
+  count = 0;
+  while (raa_extract_1_seq(opaque, &message))
+  {
+    count++;
+  }
+  if (message != NULL)
+  {
+    string error = message;
+    free(message);
+    throw error;
+  }
+  return count;
+}
+
+
+void RAA::getSeqs_pipelined(const vector<int>& seqranks, int maxlength, unsigned int window,
+    vector<unique_ptr<Sequence> >& seqs)
+{
+  struct fragment
+  {
+    size_t seq;
+    int first;
+  };
+  vector<size_t> todo;
+  vector<fragment> fragments;
+  size_t sent, received;
+
+  if (window == 0)
+    window = 1;
+  seqs.clear();
+  seqs.resize(seqranks.size());
+  for (size_t i = 0; i < seqranks.size(); i++)
+  {
+    if (seqranks[i] >= 2 && seqranks[i] <= raa_data->nseq)
+      todo.push_back(i);
+  }
+  size_t total = todo.size();
+  vector<string> names(total), descriptions(total), data(total);
+  vector<int> lengths(total, -1);
+
+  // first pass: attributes of all sequences, keeping up to window commands in flight
+  sent = received = 0;
+  while (received < total)
+  {
+    while (sent < total && sent - received < window)
+    {
+      raa_getattributes_send(raa_data, NULL, seqranks[todo[sent++]], FALSE);
+    }
+    char* description;
+    int length;
+    char* name = raa_getattributes_receive(raa_data, NULL, &length, NULL, NULL, NULL, &description, NULL, NULL);
+    if (name != NULL && length <= maxlength)
+    {
+      names[received] = name;
+      descriptions[received] = description;
+      lengths[received] = length;
+    }
+    received++;
+  }
+
+  // second pass: sequence data, downloaded as pipelined fragments of RAA_GFRAG_BSIZE residues
+  for (size_t i = 0; i < total; i++)
+  {
+    if (lengths[i] == 0)
+      seqs[todo[i]] = make_unique<Sequence>(names[i], "", vector<string>(1, descriptions[i]), getAlphabet());
+    for (int first = 1; first <= lengths[i]; first += RAA_GFRAG_BSIZE)
+    {
+      fragments.push_back({ i, first });
+    }
+  }
+  sent = received = 0;
+  while (received < fragments.size())
+  {
+    while (sent < fragments.size() && sent - received < window)
+    {
+      const fragment& f = fragments[sent++];
+      raa_gfrag_send(raa_data, seqranks[todo[f.seq]], f.first, RAA_GFRAG_BSIZE);
+    }
+    const fragment& f = fragments[received++];
+    string& cseq = data[f.seq];
+    int length = lengths[f.seq];
+    if (cseq.empty())
+      cseq.assign(length + 1, ' ');
+    raa_gfrag_receive(raa_data, &cseq[f.first - 1], min(RAA_GFRAG_BSIZE, length - f.first + 1));
+    if (f.first + RAA_GFRAG_BSIZE > length)
+    {
+      cseq.resize(length);
+      seqs[todo[f.seq]] = make_unique<Sequence>(names[f.seq], cseq, vector<string>(1, descriptions[f.seq]),
+          getAlphabet());
+      string().swap(cseq);
+    }
+  }
+}
+
+
 int RAA::getSeqFrag(int seqrank, int first, int length, string& sequence)
 {
   if (seqrank < 2 || seqrank > raa_data->nseq)
@@ -114,6 +317,24 @@ int RAA::getSeqFrag(int seqrank, int first, int length, string& sequence)
 }
 
 
+void RAA::setReadAhead(int blocks)
+{
+  raa_gfrag_set_ahead(raa_data, blocks);
+}
+
+
+void RAA::setSeqCacheSize(size_t bytes)
+{
+  raa_gfrag_set_budget(raa_data, bytes);
+}
+
+
+void RAA::setShortListCacheSize(int records)
+{
+  raa_readshrt_set_capacity(raa_data, records);
+}
+
+
 int RAA::getSeqFrag(const string& name_or_accno, int first, int length, string& sequence)
 {
   int seqrank;
@@ -190,6 +411,12 @@ int RAA::knownDatabases(vector<string>& name, vector<string>& description)
 }
 
 
+void RAA::setCompression(bool compress)
+{
+  raa_set_zlib(raa_data, compress);
+}
+
+
 int RAA::openDatabase(const string& dbname, char* (*getpasswordf)(void*), void* p)
 {
   current_address.div = -1;
@@ -292,6 +519,85 @@ unique_ptr<Sequence> RAA::translateCDS(const string& name)
 }
 
 
+unique_ptr<VectorSequenceContainer> RAA::translateCDSs(RaaList& list, unsigned int window)
+{
+  vector<int> ranks, partial;
+  int rank, prank, type;
+  char* message;
+
+  if (list.getType() != RaaList::LIST_SEQUENCES)
+    throw string("List must contain sequences");
+  if (window == 0)
+    window = 1;
+  rank = 0;
+  while ((rank = raa_nexteltinlist(raa_data, rank, list.getRank(), NULL, NULL)) != 0)
+  {
+    ranks.push_back(rank);
+  }
+  // 5'-partial CDSs of the list are found by a single server-side query rather than
+  // by following the keyword chain of each sequence
+  if (raa_data->num_5_partial == 0)
+    raa_data->num_5_partial = raa_iknum(raa_data, (char*)"5'-PARTIAL", raa_key);
+  if (raa_data->num_5_partial != 0 && !ranks.empty())
+  {
+    // the server names the list, so that no list of the user is replaced
+    string query = list.getName() + " and k=5'-PARTIAL";
+    if (raa_proc_query(raa_data, (char*)query.c_str(), &message, NULL, &prank, NULL, NULL, &type))
+    {
+      string errmess = message;
+      free(message);
+      throw errmess;
+    }
+    rank = 0;
+    while ((rank = raa_nexteltinlist(raa_data, rank, prank, NULL, NULL)) != 0)
+    {
+      partial.push_back(rank);
+    }
+    raa_releaselist(raa_data, prank);
+  }
+
+  auto alphaPtr = dynamic_pointer_cast<const Alphabet>(AlphabetTools::PROTEIN_ALPHABET);
+  auto container = make_unique<VectorSequenceContainer>(alphaPtr);
+  size_t sent = 0, received = 0;
+  try
+  {
+    while (received < ranks.size())
+    {
+      while (sent < ranks.size() && sent - received < window)
+      {
+        raa_getattributes_send(raa_data, NULL, ranks[sent++], TRUE);
+      }
+      char* descript, * seq = NULL;
+      int length, frame, gc;
+      char* name = raa_getattributes_receive(raa_data, NULL, &length, &frame, &gc, NULL, &descript, NULL, &seq);
+      rank = ranks[received++];
+      if (name == NULL || seq == NULL)
+        continue;
+      bool special_init = frame == 0 && !binary_search(partial.begin(), partial.end(), rank);
+      // seq points to the reply line: it must be translated before the next reply is read
+      char* prot = raa_translate_cds_seq(raa_data, seq + frame, length - frame, gc, special_init);
+      if (prot == NULL)
+        continue;
+      int l = strlen(prot) - 1;
+      if (l >= 0 && prot[l] == '*')
+        prot[l] = 0;
+      auto Sprot = make_unique<Sequence>(name, prot, vector<string>(1, descript), alphaPtr);
+      container->addSequence(Sprot->getName(), Sprot);
+    }
+  }
+  catch (...)
+  {
+    char* seq;
+    while (received++ < sent)
+    {
+      raa_getattributes_receive(raa_data, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &seq);
+    }
+    throw;
+  }
+  return container;
+}
+
+
 char RAA::translateInitCodon(int seqrank)
 {
   if (seqrank < 2 || seqrank > raa_data->nseq)
@@ -300,6 +606,15 @@ char RAA::translateInitCodon(int seqrank)
 }
 
 
+string RAA::translate(const string& nucleotides, int gc)
+{
+  string protein(nucleotides.size() / 3, 0);
+  if (!protein.empty())
+    translate_nucleotides(nucleotides.data(), nucleotides.size(), gc, &protein[0]);
+  return protein;
+}
+
+
 unique_ptr<RaaList> RAA::processQuery(const string& query, const string& listname)
 {
   char* message;
@@ -359,6 +674,71 @@ unique_ptr<RaaList> RAA::createEmptyList(const string& listname, const string& k
 }
 
 
+unique_ptr<RaaList> RAA::createListFromNames(const vector<string>& names, const string& listname,
+    const string& kind, bool accessions)
+{
+  const string* type;
+  const char* datatype;
+  int lrank;
+
+  if (kind == RaaList::LIST_SEQUENCES)
+  {
+    type = &RaaList::LIST_SEQUENCES;
+    datatype = accessions ? "AC" : "SQ";
+  }
+  else if (kind == RaaList::LIST_KEYWORDS)
+  {
+    type = &RaaList::LIST_KEYWORDS;
+    datatype = "KW";
+  }
+  else
+  {
+    type = &RaaList::LIST_SPECIES;
+    datatype = "SP";
+  }
+  vector<char*> items(names.size());
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    items[i] = (char*)names[i].c_str();
+  }
+  int err = raa_crelistfromclientdata(raa_data, datatype, items.data(), (int)items.size(), &lrank, NULL);
+  if (err == -1)
+    throw string("connection with server is down");
+  else if (err == 3)
+    throw string("too many lists, delete a few");
+  else if (err != 0)
+    throw string("list creation failed, code=") + to_string(err);
+  if (raa_setlistname(raa_data, lrank, (char*)listname.c_str()) != 0)
+  {
+    raa_releaselist(raa_data, lrank);
+    throw string("a list named ") + listname + " already exists";
+  }
+  unique_ptr<RaaList> mylist(new RaaList()); // Note: cannot use make_unique because of private constructor.
+  mylist->myraa = this;
+  mylist->rank = lrank;
+  mylist->name = listname;
+  mylist->type = type;
+  return mylist;
+}
+
+
+unique_ptr<RaaList> RAA::createListFromRanks(const vector<int>& ranks, const string& listname, const string& kind)
+{
+  auto mylist = createEmptyList(listname, kind);
+  try
+  {
+    mylist->addElements(ranks);
+  }
+  catch (...)
+  {
+    // the list would otherwise stay on the server, under the name given
+    raa_releaselist(raa_data, mylist->rank);
+    throw;
+  }
+  return mylist;
+}
+
+
 void RAA::deleteList(RaaList* list)
 {
   raa_releaselist(raa_data, list->rank);
@@ -410,44 +790,32 @@ unique_ptr<RaaSpeciesTree> RAA::loadSpeciesTree(bool showprogress)
     return nullptr;
   if (showprogress && (!init_load_mess) )
     cout << "\nSpecies tree download completed\n";
+  return makeSpeciesTree();
+}
+
+
+unique_ptr<RaaSpeciesTree> RAA::mapSpeciesTree(const string& path)
+{
+  if (raa_map_taxonomy(raa_data, path.c_str()) != 0)
+    return nullptr;
+  return makeSpeciesTree();
+}
+
+
+unique_ptr<RaaSpeciesTree> RAA::makeSpeciesTree()
+{
   auto tree = make_unique<RaaSpeciesTree>();
   tree->raa_data = raa_data;
   tree->sp_tree = raa_data->sp_tree;
   tree->tid_to_rank = raa_data->tid_to_rank;
   tree->max_tid = raa_data->max_tid;
-  tree->max_sp = raa_read_first_rec(raa_data, raa_spec);
   return tree;
 }
 
 
 void RAA::freeSpeciesTree(RaaSpeciesTree* tree)
 {
-  int i;
-  struct raa_pair* p, * q;
-  for (i = 2; i <= tree->max_sp; i++)
-  {
-    if (raa_data->sp_tree[i] == NULL)
-      continue;
-    free(raa_data->sp_tree[i]->name);
-    if (raa_data->sp_tree[i]->libel != NULL)
-      free(raa_data->sp_tree[i]->libel);
-    if (raa_data->sp_tree[i]->libel_upcase != NULL)
-      free(raa_data->sp_tree[i]->libel_upcase);
-    p = raa_data->sp_tree[i]->list_desc;
-    while (p)
-    {
-      q = p->next;
-      free(p);
-      p = q;
-    }
-    free(raa_data->sp_tree[i]);
-  }
-  if (raa_data->tid_to_rank != NULL)
-    free(raa_data->tid_to_rank);
-  if (raa_data->sp_tree != NULL)
-    free(raa_data->sp_tree);
-  raa_data->sp_tree = NULL;
-  raa_data->tid_to_rank = NULL;
+  raa_free_taxonomy(raa_data);
   delete tree;
 }
 
@@ -555,10 +923,18 @@ void* RAA::prepareGetAnyFeature(int seqrank, const string& featurekey)
   if (seqrank < 2 || seqrank > raa_data->nseq)
     throw "Incorrect first argument";
   struct extract_data* data = new struct extract_data;
-  sock_printf(raa_data, "extractseqs&seqnum=%d&format=fasta&operation=feature&feature=%s&zlib=F\n", seqrank, featurekey.c_str());
+  sock_printf(raa_data, "extractseqs&seqnum=%d&format=fasta&operation=feature&feature=%s&zlib=%c\n",
+      seqrank, featurekey.c_str(), raa_data->zlib_replies ? 'T' : 'F');
   line = read_sock(raa_data);
+  if (line == NULL)
+  {
+    delete data;
+    return NULL;
+  }
   if (strcmp(line, "code=0") == 0)
   {
+    if (raa_data->zlib_replies)
+      raa_zlib_open(raa_data);
     p = read_sock(raa_data);
     strcpy(data->line, p);
     return (void*)data;
@@ -591,6 +967,7 @@ unique_ptr<Sequence> RAA::getNextFeature(void* v)
   }
   if (strcmp(data->line, "extractseqs END.") == 0)
   {
+    raa_zlib_close(raa_data);
     delete data;
     return nullptr;
   }
@@ -629,10 +1006,11 @@ void RAA::interruptGetAnyFeature(void* v)
   sock_fputs(raa_data, (char*)"\033" /* esc */);
   sock_flush(raa_data);
   p = data->line;
-  while (strcmp(p, "extractseqs END.") != 0)
+  while (p != NULL && strcmp(p, "extractseqs END.") != 0)
   {
     p = read_sock(raa_data);
   }
+  raa_zlib_close(raa_data);
   delete data;
   /* just to consume ESC that may have arrived after extractseqs END. */
   sock_fputs(raa_data, (char*)"null_command\n");
@@ -33,10 +33,13 @@ extern "C" {
 // From the STL:
 #include <string>
 #include <memory>
+#include <ostream>
+#include <functional>
 
 // From bpp-seq:
 #include <Bpp/Seq/Sequence.h>
 #include <Bpp/Seq/Alphabet/AlphabetTools.h>
+#include <Bpp/Seq/Container/VectorSequenceContainer.h>
 
 #include "RaaList.h"
 #include "RaaSpeciesTree.h"
@@ -83,6 +86,7 @@ public:
 class RAA
 {
   friend class RaaList;
+  friend class RaaAsync;
 
 public:
   /**
@@ -164,6 +168,17 @@ public:
    */
   int knownDatabases(std::vector<std::string>& name, std::vector<std::string>& description);
 
+  /**
+   * @brief Sets whether the server is asked to compress bulk replies.
+
+   * Compressed replies are much smaller (about 4-fold for nucleotide sequences), at the cost of some processor time
+   * on both sides. They are used by prepareGetAnyFeature() and the bulk sequence extraction functions.
+   * The species tree (loadSpeciesTree()) is always transferred compressed.
+   *
+   * @param compress   true to ask for compressed replies (the default is false).
+   */
+  void setCompression(bool compress);
+
   /** @} */
 
   /**
@@ -215,6 +230,75 @@ public:
    */
   std::unique_ptr<Sequence> getSeq(int seqrank, int maxlength = 100000);
 
+  /**
+   * @brief Returns several sequences identified by their database ranks.
+   *
+   * Requests are pipelined on the network connection: up to window commands are sent to the server
+   * before their replies are read, so that the download of many short sequences is not limited
+   * by the network round trip time.
+   *
+   * @param seqranks  The database ranks of the desired sequences.
+   * @param maxlength The maximum sequence length beyond which a sequence is not returned.
+   * @param window    The maximum number of commands sent to the server ahead of their replies.
+   * @return          A container with the database sequences, each including a one-line comment,
+   * in the order of seqranks. Ranks that do not match any sequence, sequences longer than maxlength,
+   * and repeated ranks are skipped.
+   */
+  std::unique_ptr<VectorSequenceContainer> getSeqs(const std::vector<int>& seqranks, int maxlength = 100000,
+      unsigned int window = 50);
+
+  /**
+   * @brief Gives the residues of a sequence, by successive chunks, to a function.
+   *
+   * Memory use does not depend on the sequence length, so that sequences of any length (e.g., whole
+   * chromosomes) can be written to disk or processed on the fly. The next chunk is requested from the server
+   * before the current one is given to the function, so that both tasks overlap.
+   *
+   * @param seqrank   The database rank of a sequence.
+   * @param sink      Function called with the address and the length of each successive chunk of residues.
+   * The data are valid only during this call.
+   * @param chunksize The number of residues requested from the server at once.
+   * @return          The number of residues processed, 0 if seqrank does not match any sequence.
+   */
+  int streamSeq(int seqrank, const std::function<void(const char*, size_t)>& sink, int chunksize = 1000000);
+
+  /**
+   * @brief Writes the residues of a sequence, by successive chunks, to a stream.
+   *
+   * @param seqrank   The database rank of a sequence.
+   * @param out       The stream where the residues are written, without any newline.
+   * @param chunksize The number of residues requested from the server at once.
+   * @return          The number of written residues, 0 if seqrank does not match any sequence.
+   */
+  int streamSeq(int seqrank, std::ostream& out, int chunksize = 1000000);
+
+  /**
+   * @brief Writes all sequences of a list to a stream in one server-side extraction.
+   *
+   * All sequences are transferred by a single compressed stream, which is much faster for large lists
+   * than successive getSeq() calls.
+   *
+   * @param list      A list of sequences.
+   * @param out       The stream where extracted sequences are written.
+   * @param format    "fasta", "flat", "acnuc" or "gcg".
+   * @param operation "simple" to extract whole sequences, "fragment" to extract the part of each sequence
+   * given by bounds, "feature" to extract all features of each sequence of type feature,
+   * or "region" to extract the part given by bounds around each such feature.
+   * @param feature   A feature key (e.g., CDS, tRNA) for operations "feature" and "region".
+   * @param bounds    The extracted part, for operations "fragment" and "region". Syntax by examples:
+   * "45,155" "-100,100" "-10,e+100" "E-10,e+100" where b and e (or B and E) mean the beginning and end
+   * of the sequence or feature.
+   * @param minbounds For operations "fragment" and "region", parts shorter than given by minbounds
+   * (same syntax as bounds) are not extracted. Empty means the same as bounds.
+   * @return          The number of extracted sequences; at most 1 for format "gcg", whose records are not
+   * delimited in the extracted data.
+   * @throw string    A message indicating the cause of the error. Sequences written before the error
+   * are complete.
+   */
+  int exportList(RaaList& list, std::ostream& out, const std::string& format = "fasta",
+      const std::string& operation = "simple", const std::string& feature = "",
+      const std::string& bounds = "", const std::string& minbounds = "");
+
   /**
    * @brief Returns any part of a sequence identified by its database rank.
    *
@@ -226,6 +310,40 @@ public:
    */
   int getSeqFrag(int seqrank, int first, int length, std::string& sequence);
 
+  /**
+   * @brief Sets how many blocks of sequence data are requested in advance when successive parts of a
+   * sequence are read by getSeqFrag() calls.
+   *
+   * Sequence data are downloaded by blocks of 10 kB. When getSeqFrag() calls progress sequentially along a
+   * sequence (e.g., a sliding window scan of a genome), the following blocks are requested before they are
+   * needed, so that the scan is not slowed down by the network round trip time.
+   *
+   * @param blocks   The number of blocks requested in advance (at most 16), 0 (the default) for none.
+   */
+  void setReadAhead(int blocks);
+
+  /**
+   * @brief Sets the memory size of the cache of sequence data.
+   *
+   * Sequence data obtained by getSeqFrag() and translateCDS() calls are kept in a cache of 10 kB blocks,
+   * so that returning to recently used parts of sequences does not download them again.
+   * Least recently used blocks are evicted first.
+   *
+   * @param bytes   The memory size of the cache (the default is 1 MB; it can't be smaller than 180 kB).
+   */
+  void setSeqCacheSize(size_t bytes);
+
+  /**
+   * @brief Sets how many records of the database short lists are kept in memory.
+   *
+   * Short list records (e.g., those linking a sequence to its keywords or a keyword to its descendants)
+   * are downloaded by groups of 50 and kept in a hash table, so that walking them again does not query the server.
+   * The table is emptied when it becomes full.
+   *
+   * @param records   The maximum number of memorized records (the default, 0, is 5000).
+   */
+  void setShortListCacheSize(int records);
+
   /**
    * @brief Returns any part of a sequence identified by its name or accession number.
    *
@@ -295,6 +413,24 @@ public:
    */
   std::unique_ptr<Sequence> translateCDS(const std::string& name);
 
+  /**
+   * @brief Returns the protein translations of all protein-coding (sub)sequences of a list.
+   *
+   * Requests are pipelined on the network connection: up to window commands are sent to the server
+   * before their replies are read. Each reply brings the complete CDS which is translated at once.
+   * CDSs annotated as 5'-PARTIAL, as well as those with a non-zero reading frame, have their first
+   * codon translated with the regular genetic code.
+   *
+   * @param list    A list of protein-coding sequences or subsequences.
+   * @param window  The maximum number of commands sent to the server ahead of their replies.
+   * @return        A container with the complete protein translations, each including a one-line comment,
+   * in the order of the list.
+   * @throw string if the list does not contain sequences or if the server rejects a query.
+   * @throw BadCharException In rare cases, a CDS may contain an internal stop codon that raises an
+   * exception when translated to protein.
+   */
+  std::unique_ptr<VectorSequenceContainer> translateCDSs(RaaList& list, unsigned int window = 50);
+
   /**
    * @brief Returns the amino acid translation of the first codon of a protein-coding (sub)sequence.
    *
@@ -305,6 +441,17 @@ public:
    */
   char translateInitCodon(int seqrank);
 
+  /**
+   * @brief Translates nucleotides to amino acids, without server access.
+   *
+   * @param nucleotides  A nucleotide sequence read from its first base; trailing bases of an
+   * incomplete codon are ignored.
+   * @param gc           The acnuc number of the genetic code, 0 for the regular code, which is also
+   * used for unknown numbers.
+   * @return             The amino acids, X for codons with a base other than ACGTU, * for stop codons.
+   */
+  static std::string translate(const std::string& nucleotides, int gc = 0);
+
   /** @} */
 
   /**
@@ -338,6 +485,38 @@ public:
    */
   std::unique_ptr<RaaList> createEmptyList(const std::string& listname, const std::string& kind = RaaList::LIST_SEQUENCES);
 
+  /**
+   * @brief Creates a list from names of database elements held in memory.
+   *
+   * All names are sent to the server at once, so that lists of any size are built by a single exchange.
+   *
+   * @param names       Sequence names (or accession numbers), species names, or keywords.
+   * @param listname    A name to be given to the resulting list. Case is not significant.
+   * @param kind        Nature of the resulting list. One of RaaList::LIST_SEQUENCES, RaaList::LIST_KEYWORDS,
+   * RaaList::LIST_SPECIES.
+   * @param accessions  For a sequence list, true means that names are accession numbers.
+   * @return            The resulting list, unless an exception was raised. Names that match no database
+   * element are ignored.
+   * @throw string    If error, the string is a message describing the error cause.
+   */
+  std::unique_ptr<RaaList> createListFromNames(const std::vector<std::string>& names, const std::string& listname,
+      const std::string& kind = RaaList::LIST_SEQUENCES, bool accessions = false);
+
+  /**
+   * @brief Creates a list from database ranks held in memory.
+   *
+   * @param ranks       Database ranks of sequences, species, or keywords.
+   * @param listname    A name to be given to the resulting list. Case is not significant.
+   * @param kind        Nature of the resulting list. One of RaaList::LIST_SEQUENCES, RaaList::LIST_KEYWORDS,
+   * RaaList::LIST_SPECIES.
+   * @return            The resulting list, unless an exception was raised.
+   * @throw int    As createEmptyList().
+   * @throw string if the ranks could not be added to the list (see RaaList::addElements()); the list
+   * is then released.
+   */
+  std::unique_ptr<RaaList> createListFromRanks(const std::vector<int>& ranks, const std::string& listname,
+      const std::string& kind = RaaList::LIST_SEQUENCES);
+
   /**
    * @brief Deletes a list and calls its destructor.
    *
@@ -464,6 +643,20 @@ public:
    */
   void freeSpeciesTree(RaaSpeciesTree* tree);
 
+  /**
+   * @brief Maps in memory a species tree previously saved by RaaSpeciesTree::save().
+   *
+   * This avoids downloading the full species tree from the server: the saved file is mapped
+   * read-only, so that several processes using the same file share its memory.
+   * The file is not used if it was saved from another database or another database release, as identified
+   * by the release and update date the server gives for the database, or if its content is inconsistent.
+   *
+   * @param path    The name of a file written by RaaSpeciesTree::save().
+   * @return   An object allowing work with the full species tree (see RaaSpeciesTree), or NULL if the file
+   * can't be used. It must be freed by freeSpeciesTree().
+   */
+  std::unique_ptr<RaaSpeciesTree> mapSpeciesTree(const std::string& path);
+
 
   /**
    * @brief    Initializes pattern-matching in database keywords. Matching keywords are then returned by successive nextMatchingKeyword() calls.
@@ -505,6 +698,10 @@ private:
   int current_kw_match;
   std::string* kw_pattern;
   std::unique_ptr<Sequence> getSeq_both(const std::string& name_or_accno, int rank, int maxlength);
+  void getSeqs_pipelined(const std::vector<int>& seqranks, int maxlength, unsigned int window,
+      std::vector<std::unique_ptr<Sequence> >& seqs);
+  std::shared_ptr<const Alphabet> getAlphabet();
+  std::unique_ptr<RaaSpeciesTree> makeSpeciesTree();
 };
 } // end of namespace bpp.
 
@@ -16,7 +16,12 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <termios.h>
+#include <pthread.h>
+#define RAA_TAXO_THREADS
 #elif defined(WIN32)
 #if _WIN32_WINNT < 0x0501
 #define _WIN32_WINNT  0x0501
@@ -36,14 +41,19 @@ int sock_flush(raa_db_access* f);
 void raa_acnucclose(raa_db_access* raa_current_db);
 static char* protect_quotes(char* name);
 static void raa_free_matchkeys(raa_db_access* raa_current_db);
+static void gfrag_drain_ahead(raa_db_access* raa_current_db);
+static void elt_drain(raa_db_access* raa_current_db);
 
 /* needed functions */
 extern char init_codon_to_aa(char* codon, int gc);
 char codaa(char* codon, int code);
-void* prepare_sock_gz_r(FILE* sockr);
-char* z_read_sock(void* v);
-int close_sock_gz_r(void* v);
+void* raa_zlib_new(raa_socket fd, const char* pending, size_t lpending);
+int raa_zlib_inflate(void* v, char* out, size_t room);
+long raa_zlib_finish(void* v);
+void raa_zlib_end(void* v, char* out);
 char* unprotect_quotes(char* name);
+int prepch(char* chaine, char** posmot);
+int compch(char* cible, int lcible, char** posmot, int nbrmots);
 
 
 /* global variables */
@@ -51,208 +61,261 @@ void (* raa_error_mess_proc)(raa_db_access*, char*) = NULL;
 
 #define MAX_RDSHRT 50 /* max short list length read in one time */
 
+/******************************************************************/
+/* socket output: commands are formatted directly into raa_current_db->sock_output
+   and sent to the server in a single write only when a reply is awaited,
+   so that commands sent in a row travel together */
+
 #if defined(WIN32)
+#define RAA_SOCK_FD(db) ((SOCKET)(db)->raa_sockfd)
+#else
+#define RAA_SOCK_FD(db) ((db)->raa_sockfd)
+#endif
 
-static int socket_getc(raa_db_access* raa_current_db, SOCKET f)
+static int sock_output_reserve(raa_db_access* raa_current_db, size_t l)
+/* makes room for l more bytes in the output buffer; returns 0, or EOF if not enough memory */
 {
-  int q;
+  size_t newsize;
+  char* p;
 
-  if (raa_current_db->sock_input_pos < raa_current_db->sock_input_end)
-  {
-    return *(raa_current_db->sock_input_pos++);
-  }
-  q = recv(f, raa_current_db->sock_input, SOCKBUFS, 0);
-  if (q == 0 || q == SOCKET_ERROR)
+  if (raa_current_db->sock_output_len + l <= raa_current_db->sock_output_size)
+    return 0;
+  newsize = raa_current_db->sock_output_size == 0 ? RAA_SOCK_WBSIZE : raa_current_db->sock_output_size;
+  while (newsize < raa_current_db->sock_output_len + l)
+    newsize *= 2;
+  p = (char*)realloc(raa_current_db->sock_output, newsize);
+  if (p == NULL)
     return EOF;
-  raa_current_db->sock_input_end = raa_current_db->sock_input + q;
-  raa_current_db->sock_input_pos = raa_current_db->sock_input;
-  return *(raa_current_db->sock_input_pos++);
+  raa_current_db->sock_output = p;
+  raa_current_db->sock_output_size = newsize;
+  return 0;
 }
 
 
-static char* sock_fgets(raa_db_access* raa_current_db, char* line, int len)
+int sock_flush(raa_db_access* raa_current_db)
 {
-  int c;
-  char* p;
+  size_t done;
+  int w;
 
-  p = line;
-  while (len > 1)
+  if (raa_current_db == NULL)
+    return EOF;
+  done = 0;
+  while (done < raa_current_db->sock_output_len)
   {
-    c = socket_getc(raa_current_db,  (SOCKET)(raa_current_db->raa_sockfdr) );
-    if (c == EOF)
+#if defined(WIN32)
+    w = send(RAA_SOCK_FD(raa_current_db), raa_current_db->sock_output + done,
+             (int)(raa_current_db->sock_output_len - done), 0);
+    if (w == SOCKET_ERROR)
+      break;
+#else
+    w = write(RAA_SOCK_FD(raa_current_db), raa_current_db->sock_output + done,
+              raa_current_db->sock_output_len - done);
+    if (w == -1)
     {
-      if (p == line)
-        return NULL;
+      if (errno == EINTR)
+        continue;
       break;
     }
-    *(p++) = c;
-    if (c == '\n')
-      break;
-    len--;
+#endif
+    done += w;
   }
-  *p = 0;
-  return line;
+  w = (done < raa_current_db->sock_output_len ? EOF : 0);
+  raa_current_db->sock_output_len = 0;
+  return w;
 }
 
 
-static int mswin_sock_flush(raa_db_access* raa_current_db)
+int sock_fputs(raa_db_access* raa_current_db, const char* s)
 {
-  int w;
-  char* p;
+  size_t l;
 
-  p = raa_current_db->sock_output;
-  while (raa_current_db->sock_output_lbuf > 0)
-  {
-    w = send((SOCKET)raa_current_db->raa_sockfdw, p, raa_current_db->sock_output_lbuf, 0);
-    raa_current_db->sock_output_lbuf -= w;
-    p += w;
-  }
+  if (raa_current_db == NULL)
+    return EOF;
+  /* a list block requested ahead must be read before the reply to any other command */
+  if (raa_current_db->elt_prefetch.outstanding != NULL && !raa_current_db->elt_prefetch.draining)
+    elt_drain(raa_current_db);
+  l = strlen(s);
+  if (sock_output_reserve(raa_current_db, l) != 0)
+    return EOF;
+  memcpy(raa_current_db->sock_output + raa_current_db->sock_output_len, s, l);
+  raa_current_db->sock_output_len += l;
   return 0;
 }
 
 
-int sock_flush(raa_db_access* raa_current_db)
+int sock_printf(raa_db_access* raa_current_db, const char* fmt, ...)
 {
+  va_list ap;
+  size_t room;
+  int l;
+
   if (raa_current_db == NULL)
-    return 0;
-  return mswin_sock_flush(raa_current_db);
+    return EOF;
+  if (raa_current_db->elt_prefetch.outstanding != NULL && !raa_current_db->elt_prefetch.draining)
+    elt_drain(raa_current_db);
+  if (sock_output_reserve(raa_current_db, 256) != 0)
+    return EOF;
+  room = raa_current_db->sock_output_size - raa_current_db->sock_output_len;
+  va_start(ap, fmt);
+  l = vsnprintf(raa_current_db->sock_output + raa_current_db->sock_output_len, room, fmt, ap);
+  va_end(ap);
+  if (l < 0)
+    return EOF;
+  if ((size_t)l >= room)
+  {
+    /* too long for the free space: format again after enlarging the buffer */
+    if (sock_output_reserve(raa_current_db, l + 1) != 0)
+      return EOF;
+    va_start(ap, fmt);
+    vsnprintf(raa_current_db->sock_output + raa_current_db->sock_output_len, l + 1, fmt, ap);
+    va_end(ap);
+  }
+  raa_current_db->sock_output_len += l;
+  return 0;
 }
 
 
-int sock_fputs(raa_db_access* raa_current_db, const char* s)
+/******************************************************************/
+/* socket input: data are read by large blocks into raa_current_db->sock_input,
+   and lines are returned in place, without copy */
+
+static int sock_fill(raa_db_access* raa_current_db)
+/* reads more data from socket at end of input buffer, moving or enlarging it as needed,
+   and inflating them if a compressed reply is being read;
+   returns the number of bytes read, 0 at end of connection, -1 if error
+ */
 {
-  int l, r;
+  size_t unread;
+  char* p;
+  int lu;
 
-  if (raa_current_db == NULL)
-    return 0;
-  l = strlen(s);
-  while (raa_current_db->sock_output_lbuf + l > SOCKBUFS)
+  unread = raa_current_db->sock_input_end - raa_current_db->sock_input_pos;
+  if (raa_current_db->sock_input_pos > 0 &&
+      raa_current_db->sock_input_size - raa_current_db->sock_input_end < RAA_SOCK_RBSIZE / 2)
   {
-    r = SOCKBUFS - raa_current_db->sock_output_lbuf;
-    memcpy(raa_current_db->sock_output + raa_current_db->sock_output_lbuf, s, r);
-    raa_current_db->sock_output_lbuf += r;
-    l -= r;
-    s += r;
-    mswin_sock_flush(raa_current_db);
+    memmove(raa_current_db->sock_input, raa_current_db->sock_input + raa_current_db->sock_input_pos, unread);
+    raa_current_db->sock_input_pos = 0;
+    raa_current_db->sock_input_end = unread;
   }
-  if (l > 0)
+  if (raa_current_db->sock_input_size - raa_current_db->sock_input_end < RAA_SOCK_RBSIZE / 2)
   {
-    memcpy(raa_current_db->sock_output + raa_current_db->sock_output_lbuf, s, l);
-    raa_current_db->sock_output_lbuf += l;
+    p = (char*)realloc(raa_current_db->sock_input,
+        raa_current_db->sock_input_size == 0 ? RAA_SOCK_RBSIZE : 2 * raa_current_db->sock_input_size);
+    if (p == NULL)
+      return -1;
+    raa_current_db->sock_input = p;
+    raa_current_db->sock_input_size = (raa_current_db->sock_input_size == 0 ?
+        RAA_SOCK_RBSIZE : 2 * raa_current_db->sock_input_size);
   }
-  return 0;
-}
-
-
+  unread = raa_current_db->sock_input_size - raa_current_db->sock_input_end;
+  if (unread > RAA_SOCK_RBSIZE)
+    unread = RAA_SOCK_RBSIZE;
+  if (raa_current_db->zlib_channel != NULL)
+  {
+    lu = raa_zlib_inflate(raa_current_db->zlib_channel, raa_current_db->sock_input + raa_current_db->sock_input_end, unread);
+    if (lu > 0)
+      raa_current_db->sock_input_end += lu;
+    return lu;
+  }
+  do
+  {
+#if defined(WIN32)
+    lu = recv(RAA_SOCK_FD(raa_current_db), raa_current_db->sock_input + raa_current_db->sock_input_end, (int)unread, 0);
 #else
-
-int sock_fputs(raa_db_access* raa_current_db, const char* s)
-{
-  if (raa_current_db == NULL)
-    return EOF;
-  return fputs(s, raa_current_db->raa_sockfdw);
+    lu = read(RAA_SOCK_FD(raa_current_db), raa_current_db->sock_input + raa_current_db->sock_input_end, unread);
+#endif
+  }
+#if defined(WIN32)
+  while (FALSE);
+#else
+  while (lu == -1 && errno == EINTR);
+#endif
+  if (lu > 0)
+    raa_current_db->sock_input_end += lu;
+  return lu < 0 ? -1 : lu;
 }
 
-int sock_flush(raa_db_access* raa_current_db)
+
+static int sock_has_line(raa_db_access* raa_current_db)
+/* tells whether a complete line is already available in the input buffer */
 {
-  if (raa_current_db == NULL)
-    return EOF;
-  return fflush(raa_current_db->raa_sockfdw);
+  return raa_current_db->sock_input_end > raa_current_db->sock_input_pos &&
+         memchr(raa_current_db->sock_input + raa_current_db->sock_input_pos, '\n',
+                raa_current_db->sock_input_end - raa_current_db->sock_input_pos) != NULL;
 }
 
-#endif /* WIN32 */
 
-
-int sock_printf(raa_db_access* raa_current_db, const char* fmt, ...)
+static void connection_down(raa_db_access* raa_current_db, const char* message)
+/* reports, once, that the connection can't be used any more; all later reads from it fail */
 {
-  va_list ap;
-  int retval;
-
-  va_start(ap, fmt);
-  vsprintf(raa_current_db->buffer, fmt, ap);
-  retval = sock_fputs(raa_current_db, raa_current_db->buffer);
-  va_end(ap);
-  return retval;
+  if (raa_current_db->was_here)
+    return;
+  raa_current_db->was_here = TRUE;
+  *raa_current_db->buffer = 0;
+  if (raa_current_db->dbname != NULL)
+  {
+    sprintf(raa_current_db->buffer, "%s: ", raa_current_db->dbname);
+  }
+  strcat(raa_current_db->buffer, message);
+  if (raa_error_mess_proc == NULL)
+  {
+    fprintf(stderr, "%s\n", raa_current_db->buffer);
+  }
+  else
+    (*raa_error_mess_proc)(raa_current_db, raa_current_db->buffer);
 }
 
 
-/******************************************************************/
-/* lit une ligne au plus de la socket et transfere le resultat dans une chaine char *   */
-
-static char* read_sock_tell(raa_db_access* raa_current_db, int* wascompleteline)
+char* read_sock_len(raa_db_access* raa_current_db, size_t* plength)
+/* lit une ligne entiere de la socket;
+   rend la ligne, sans son \n final, directement dans le buffer d'entree : elle reste valide jusqu'a
+   la lecture suivante ; et rend sa longueur dans *plength si plength != NULL
+ */
 {
-  int lnbuf, isfull;
-  char* p;
+  char* line, * eol;
+  size_t scanned, l;
 
   if (raa_current_db == NULL || raa_current_db->was_here)
     return NULL;
+  /* replies to blocks read ahead come before any other reply */
+  if (raa_current_db->gfrag_data.ahead_pending > 0 && !raa_current_db->gfrag_data.draining)
+    gfrag_drain_ahead(raa_current_db);
   sock_flush(raa_current_db); /* tres important */
-  isfull = FALSE;
-#if defined(WIN32)
-  p = sock_fgets(raa_current_db, raa_current_db->buffer, sizeof(raa_current_db->buffer));
-#else
-  p = fgets(raa_current_db->buffer, sizeof(raa_current_db->buffer), raa_current_db->raa_sockfdr);
-#endif
-  if (p == NULL || strcmp(p, SERVER_UPDATE_MESSAGE) == 0)
+  if (raa_current_db->sock_input_pos == raa_current_db->sock_input_end)
+    raa_current_db->sock_input_pos = raa_current_db->sock_input_end = 0;
+  scanned = 0;
+  while ((eol = (char*)memchr(raa_current_db->sock_input + raa_current_db->sock_input_pos + scanned, '\n',
+                              raa_current_db->sock_input_end - raa_current_db->sock_input_pos - scanned)) == NULL)
+  {
+    scanned = raa_current_db->sock_input_end - raa_current_db->sock_input_pos;
+    if (sock_fill(raa_current_db) <= 0)
+      break;
+  }
+  line = raa_current_db->sock_input + raa_current_db->sock_input_pos;
+  if (eol == NULL || (eol - line == sizeof(SERVER_UPDATE_MESSAGE) - 2 &&
+                      strncmp(line, SERVER_UPDATE_MESSAGE, sizeof(SERVER_UPDATE_MESSAGE) - 2) == 0) )
   {
-    if (!raa_current_db->was_here)
-    {
-      raa_current_db->was_here = TRUE;
-      *raa_current_db->buffer = 0;
-      if (raa_current_db != NULL && raa_current_db->dbname != NULL)
-      {
-        sprintf(raa_current_db->buffer, "%s: ", raa_current_db->dbname);
-      }
-      strcat(raa_current_db->buffer, ( p == NULL ?
-          "Error: connection to acnuc server is down. Please try again."
-                                       :
-          "Error: acnuc server is down for database update. Please try again later." )
-          );
-      if (raa_error_mess_proc == NULL)
-      {
-        fprintf(stderr, "%s\n", raa_current_db->buffer);
-      }
-      else
-        (*raa_error_mess_proc)(raa_current_db, raa_current_db->buffer);
-    }
+    connection_down(raa_current_db, ( eol == NULL ?
+        "Error: connection to acnuc server is down. Please try again."
+                                     :
+        "Error: acnuc server is down for database update. Please try again later." )
+        );
     return NULL;
   }
-
-  raa_current_db->was_here = FALSE;
-  lnbuf = strlen(raa_current_db->buffer);
-  p = raa_current_db->buffer + lnbuf - 1;
-  if (*p ==  '\n')
-    isfull = TRUE;
-  while (p >= raa_current_db->buffer && (*p ==  '\n' || *p == '\r') )
-    *(p--) = 0;
-  if (wascompleteline != NULL)
-    *wascompleteline = isfull;
-  return raa_current_db->buffer;
+  raa_current_db->sock_input_pos = eol + 1 - raa_current_db->sock_input;
+  l = eol - line;
+  while (l > 0 && line[l - 1] == '\r')
+    l--;
+  line[l] = 0;
+  if (plength != NULL)
+    *plength = l;
+  return line;
 }
 
 
 char* read_sock(raa_db_access* raa_current_db) /* lit une ligne entiere, rend ligne dans memoire privee */
 {
-  int wasfull, l2, l = 0;
-  char* p;
-
-  do
-  {
-    p = read_sock_tell(raa_current_db, &wasfull);
-    if (p == NULL)
-      return NULL;
-    l2 = strlen(p);
-    if (l + l2 +  1 > raa_current_db->max_full_line)
-    {
-      raa_current_db->max_full_line = l + l2 +  100;
-      raa_current_db->full_line = (char*)realloc(raa_current_db->full_line, raa_current_db->max_full_line);
-    }
-    memcpy(raa_current_db->full_line + l, p, l2);
-    l += l2;
-  }
-  while (!wasfull);
-  raa_current_db->full_line[l] = 0;
-  return raa_current_db->full_line;
+  return read_sock_len(raa_current_db, NULL);
 }
 
 
@@ -266,13 +329,16 @@ char* read_sock_timeout(raa_db_access* raa_current_db, int timeout_ms)
   SOCKET fd;
   if (raa_current_db == NULL)
     return NULL;
-  fd = (SOCKET)(raa_current_db->raa_sockfdr);
+  fd = RAA_SOCK_FD(raa_current_db);
 #else
   int fd;
   if (raa_current_db == NULL)
     return NULL;
-  fd = fileno(raa_current_db->raa_sockfdr);
+  fd = RAA_SOCK_FD(raa_current_db);
 #endif
+  gfrag_drain_ahead(raa_current_db);
+  if (sock_has_line(raa_current_db))
+    return read_sock(raa_current_db);
   FD_ZERO(&readfds);
   FD_SET(fd, &readfds);
   tout.tv_sec = timeout_ms / 1000; tout.tv_usec = 1000 * (timeout_ms % 1000);
@@ -284,6 +350,76 @@ char* read_sock_timeout(raa_db_access* raa_current_db, int timeout_ms)
   return NULL;
 }
 
+int raa_zlib_open(raa_db_access* raa_current_db)
+/* the rest of the current reply is zlib-compressed: next read_sock calls return inflated lines
+   until raa_zlib_close is called; returns 0 iff OK; if the inflater can't be created, the connection,
+   whose next data can't be read, is reported down
+ */
+{
+  void* channel;
+
+  if (raa_current_db == NULL || raa_current_db->zlib_channel != NULL)
+    return 1;
+  gfrag_drain_ahead(raa_current_db);
+  sock_flush(raa_current_db);
+  /* compressed data may already be in the socket input buffer */
+  channel = raa_zlib_new(raa_current_db->raa_sockfd,
+      raa_current_db->sock_input + raa_current_db->sock_input_pos,
+      raa_current_db->sock_input_end - raa_current_db->sock_input_pos);
+  if (channel == NULL)
+  {
+    connection_down(raa_current_db, "Error: not enough memory to read compressed reply from acnuc server.");
+    return 1;
+  }
+  raa_current_db->sock_input_pos = raa_current_db->sock_input_end = 0;
+  raa_current_db->zlib_channel = channel;
+  return 0;
+}
+
+
+void raa_zlib_close(raa_db_access* raa_current_db)
+/* back to uncompressed replies once the compressed reply was read (the last inflated line is
+   usually "xxx END."); any inflated data not read yet are discarded;
+   if the rest of the compressed reply or the data that follow it can't be read, the connection
+   is reported down
+ */
+{
+  long l;
+  char* p;
+
+  if (raa_current_db == NULL || raa_current_db->zlib_channel == NULL)
+    return;
+  raa_current_db->sock_input_pos = raa_current_db->sock_input_end = 0;
+  l = raa_zlib_finish(raa_current_db->zlib_channel);
+  if (l > 0 && raa_current_db->sock_input_size < (size_t)l)
+  {
+    p = (char*)realloc(raa_current_db->sock_input, l);
+    if (p == NULL)
+      l = -1;
+    else
+    {
+      raa_current_db->sock_input = p;
+      raa_current_db->sock_input_size = l;
+    }
+  }
+  /* raw data that follow the compressed stream are put back in the input buffer */
+  raa_zlib_end(raa_current_db->zlib_channel, l > 0 ? raa_current_db->sock_input : NULL);
+  raa_current_db->zlib_channel = NULL;
+  if (l < 0)
+    connection_down(raa_current_db, "Error: compressed reply from acnuc server was lost. Please try again.");
+  else
+    raa_current_db->sock_input_end = l;
+}
+
+
+void raa_set_zlib(raa_db_access* raa_current_db, int on)
+/* on: TRUE to request zlib-compressed replies from commands that allow them */
+{
+  if (raa_current_db != NULL)
+    raa_current_db->zlib_replies = on;
+}
+
+
 enum {errservname = 1, /* bad server name */
       cantopensocket,  /* 2 error opening socket */
       unknowndb,  /* 3 not in list of known dbs */
@@ -339,6 +475,23 @@ int raa_acnucopen_alt (const char* serveurName, int port, const char* db_name, c
 }
 
 
+static int open_socket_failed(raa_db_access* raa_current_db, int code)
+/* closes the socket of a connection that could not be opened, frees its memory and returns code */
+{
+#ifdef WIN32
+  closesocket(RAA_SOCK_FD(raa_current_db));
+#else
+  close(RAA_SOCK_FD(raa_current_db));
+#endif
+  if (raa_current_db->sock_input != NULL)
+    free(raa_current_db->sock_input);
+  if (raa_current_db->sock_output != NULL)
+    free(raa_current_db->sock_output);
+  free(raa_current_db);
+  return code;
+}
+
+
 int raa_open_socket(const char* serveurName, int port, const char* clientid, raa_db_access** psock)
 /*
    clientid: NULL or a string identifying the client
@@ -376,46 +529,27 @@ int raa_open_socket(const char* serveurName, int port, const char* clientid, raa
     return cantopensocket;
   }
 #endif
-/* creation de deux flux type FILE * */
-#if defined(WIN32)
-  raa_current_db->raa_sockfdr = (FILE*)raa_snum;
-  raa_current_db->raa_sockfdw = (FILE*)raa_snum;
-#else
-  raa_current_db->raa_sockfdr = fdopen(raa_snum, "r");
-  raa_current_db->raa_sockfdw = fdopen(raa_snum, "a");
-#endif
+  raa_current_db->raa_sockfd = (raa_socket)raa_snum;
 
   sprintf(portstring, "%d", port);
   err = getaddrinfo(serveurName, portstring, NULL, &ai);
   if (err)
-  {
-    free(raa_current_db);
-    return errservname;
-  }
+    return open_socket_failed(raa_current_db, errservname);
   err = connect(raa_snum, ai->ai_addr, ai->ai_addrlen);
   freeaddrinfo(ai);
 
   if (err != 0)
-  {
-    free(raa_current_db);
-    return cantopensocket;
-  }
+    return open_socket_failed(raa_current_db, cantopensocket);
   // read first reply from the server
   reponse = read_sock_timeout(raa_current_db, 1000 * 60 /* 1 min */);
   if (reponse == NULL || strcmp(reponse, "OK acnuc socket started") != 0)
-  {
-    free(raa_current_db);
-    return cantopensocket;
-  }
+    return open_socket_failed(raa_current_db, cantopensocket);
   if (clientid != NULL)
   {
     sock_printf(raa_current_db, "clientid&id=\"%s\"\n", clientid);
     reponse = read_sock(raa_current_db);
     if (reponse == NULL)
-    {
-      free(raa_current_db);
-      return cantopensocket;
-    }
+      return open_socket_failed(raa_current_db, cantopensocket);
   }
   *psock = raa_current_db;
   return 0;
@@ -482,13 +616,9 @@ int raa_opendb_pw(raa_db_access* raa_current_db, const char* db_name, void* ptr,
   }
 
   /* initialiser les champs non nuls */
-  raa_current_db->gfrag_data.l_nseq_buf = INT_MAX;
+  raa_gfrag_clear(raa_current_db);
   raa_current_db->nextelt_data.current_rank = -1;
   raa_current_db->nextelt_data.previous = -2;
-  raa_current_db->readshrt_data.shrt_begin = S_BUF_SHRT - 1;
-#ifdef WIN32
-  raa_current_db->sock_input_pos = raa_current_db->sock_input; raa_current_db->sock_input_end = raa_current_db->sock_input;
-#endif
   p = val(rep, "type");
   raa_current_db->dbname = strdup(db_name);
   raa_current_db->genbank = raa_current_db->embl = raa_current_db->swissprot =
@@ -649,131 +779,446 @@ int raa_decode_address(char* url, char** p_ip_name, int* socket, char** p_remote
 }
 
 
-static int fill_gfrag_buf(raa_db_access* raa_current_db, int nsub, int first)
+int raa_gfrag_send(raa_db_access* raa_current_db, int nsub, int first, int lfrag)
+/* sends a gfrag command without waiting for its reply, that must be later read by raa_gfrag_receive.
+   Several such commands can be sent in a row to pipeline sequence downloads.
+ */
+{
+  if (raa_current_db == NULL)
+    return EOF;
+  return sock_printf(raa_current_db, "gfrag&number=%d&start=%d&length=%d\n", nsub, first, lfrag);
+}
+
+
+char* raa_gfrag_receive_view(raa_db_access* raa_current_db, int* plength)
+/* reads the reply to the oldest gfrag command sent by raa_gfrag_send,
+   and returns the residues in place in the socket input buffer (valid until next read from socket)
+   or NULL if error; *plength is set to the number of residues
+ */
 {
   char* p, * line;
-  int lu, l, wasfull;
+  size_t l;
 
-  sock_printf(raa_current_db, "gfrag&number=%d&start=%d&length=%d\n", nsub, first, RAA_GFRAG_BSIZE);
+  *plength = 0;
 /* retour:  length=xx&...the seq...\n */
-  line = read_sock_tell(raa_current_db, &wasfull);
+  line = read_sock_len(raa_current_db, &l);
   if (line == NULL)
-    return 0;
+    return NULL;
   if (strncmp(line, "length=", 7) != 0 || (p = strchr(line, '&')) == NULL)
   {
-    return 0;
-  }
-  lu = strlen(++p);
-  memcpy(raa_current_db->gfrag_data.buffer, p, lu);
-  while (!wasfull)
-  {
-    line = read_sock_tell(raa_current_db, &wasfull);
-    if (line == NULL)
-      break;
-    l = strlen(line);
-    if (lu + l <= RAA_GFRAG_BSIZE)
-      memcpy(raa_current_db->gfrag_data.buffer + lu, line, l);
-    lu += l;
+    return NULL;
   }
-  raa_current_db->gfrag_data.buffer[lu] = 0;
-  return lu;
+  p++;
+  *plength = (int)(l - (p - line));
+  return p;
 }
 
 
-int raa_gfrag(raa_db_access* raa_current_db, int nsub, int first, int lfrag, char* dseq)
+int raa_gfrag_receive(raa_db_access* raa_current_db, char* dseq, int maxlen)
+/* reads the reply to the oldest gfrag command sent by raa_gfrag_send,
+   copies at most maxlen residues in dseq followed by \0,
+   and returns the number of copied residues (0 if error)
+ */
 {
-  int lu, piece;
-  char* debut;
+  char* p;
+  int lu;
 
-  if (raa_current_db == NULL)
+  p = raa_gfrag_receive_view(raa_current_db, &lu);
+  if (p == NULL)
     return 0;
-  if (raa_current_db->gfrag_data.lbuf == 0 || nsub != raa_current_db->gfrag_data.nseq_buf ||
-      first >= raa_current_db->gfrag_data.first_buf + raa_current_db->gfrag_data.lbuf ||
-      first < raa_current_db->gfrag_data.first_buf)
-  {
-    if (nsub == raa_current_db->gfrag_data.nseq_buf && first > raa_current_db->gfrag_data.l_nseq_buf)
-      lu = 0;
-    else
-      lu = fill_gfrag_buf(raa_current_db, nsub, first);
-
-    if (lu == 0)
-      return 0;
-    raa_current_db->gfrag_data.lbuf = lu;
-    if (raa_current_db->gfrag_data.lbuf < RAA_GFRAG_BSIZE)
-      raa_current_db->gfrag_data.l_nseq_buf = first + raa_current_db->gfrag_data.lbuf - 1;
-    else
-      raa_current_db->gfrag_data.l_nseq_buf = INT_MAX;
-    raa_current_db->gfrag_data.first_buf = first;
-    raa_current_db->gfrag_data.nseq_buf = nsub;
-  }
-  debut = raa_current_db->gfrag_data.buffer + (first - raa_current_db->gfrag_data.first_buf);
-  lu = raa_current_db->gfrag_data.lbuf + raa_current_db->gfrag_data.first_buf - 1 - first + 1;
-  if (lu > lfrag)
-    lu = lfrag;
-  memcpy(dseq, debut, lu);
-  while (lfrag > lu)
-  {
-    piece = raa_gfrag(raa_current_db, nsub, first + lu, lfrag - lu, dseq + lu);
-    if (piece == 0)
-      break;
-    lu += piece;
-  }
+  if (lu > maxlen)
+    lu = maxlen;
+  memcpy(dseq, p, lu);
   dseq[lu] = 0;
   return lu;
 }
 
 
-static void raa_free_sp_tree(raa_node* pere)
+/* sequence data obtained by gfrag are kept in a cache of blocks of RAA_GFRAG_BSIZE residues aligned on
+   multiples of RAA_GFRAG_BSIZE, whose memory size is set by raa_gfrag_set_budget; least recently used blocks
+   are evicted first.
+   When raa_gfrag calls walk sequentially through a sequence, the next blocks are requested before they
+   are needed (read-ahead); their replies are read when needed, or before any other reply
+ */
+
+static int gfrag_init(raa_db_access* raa_current_db)
+/* allocates the block cache if needed; returns 0 iff OK */
 {
-  raa_node* next, * tmp_n;
-  struct raa_pair* liste, * tmp_p;
+  struct gfrag_aux* g = &raa_current_db->gfrag_data;
+  int i;
 
-  liste = pere->list_desc;
-  while (liste != NULL)
-  {
-    tmp_p = liste->next;
-    raa_free_sp_tree(liste->value);
-    free(liste);
-    liste = tmp_p;
-  }
-  next = pere->syno;
-  while (next != NULL && next != pere)
-  {
-    tmp_n = next->syno;
-    free(next->name);
-    free(next);
-    next = tmp_n;
+  if (g->blocks != NULL)
+    return 0;
+  g->max_blocks = (int)((g->budget == 0 ? RAA_GFRAG_BUDGET : g->budget) / RAA_GFRAG_BSIZE);
+  if (g->max_blocks < RAA_GFRAG_MAXAHEAD + 2)
+    g->max_blocks = RAA_GFRAG_MAXAHEAD + 2;
+  g->hash_size = 2 * g->max_blocks + 1;
+  g->blocks = (struct gfrag_block*)calloc(g->max_blocks, sizeof(struct gfrag_block));
+  g->hash = (int*)malloc(g->hash_size * sizeof(int));
+  if (g->blocks == NULL || g->hash == NULL)
+  {
+    if (g->blocks != NULL)
+      free(g->blocks);
+    if (g->hash != NULL)
+      free(g->hash);
+    g->blocks = NULL;
+    g->hash = NULL;
+    return 1;
   }
-  free(pere->name);
-  if (pere->libel != NULL)
-    free(pere->libel);
-  if (pere->libel_upcase != NULL)
-    free(pere->libel_upcase);
-  free(pere);
+  for (i = 0; i < g->hash_size; i++)
+    g->hash[i] = -1;
+  for (i = 0; i < g->max_blocks; i++)
+    g->blocks[i].next = i + 1;
+  g->blocks[g->max_blocks - 1].next = -1;
+  g->free_slot = 0;
+  g->newest = g->oldest = -1;
+  g->last_nseq = g->end_nseq = 0;
+  return 0;
 }
 
 
-void raa_acnucclose(raa_db_access* raa_current_db)
+static int gfrag_hash(struct gfrag_aux* g, int nseq, int index)
 {
-  char* reponse;
-  int i;
+  return (int)(((unsigned)nseq * 2654435761u + (unsigned)index) % (unsigned)g->hash_size);
+}
 
-  if (raa_current_db == NULL)
+
+static int gfrag_find(struct gfrag_aux* g, int nseq, int index)
+/* returns the cache slot of a block, or -1 if absent */
+{
+  int slot;
+
+  slot = g->hash[gfrag_hash(g, nseq, index)];
+  while (slot != -1 && (g->blocks[slot].nseq != nseq || g->blocks[slot].index != index))
+    slot = g->blocks[slot].next;
+  return slot;
+}
+
+
+static void gfrag_unlink(struct gfrag_aux* g, int slot)
+/* removes a slot from the least recently used list */
+{
+  struct gfrag_block* block = &g->blocks[slot];
+
+  if (block->older != -1)
+    g->blocks[block->older].newer = block->newer;
+  else
+    g->oldest = block->newer;
+  if (block->newer != -1)
+    g->blocks[block->newer].older = block->older;
+  else
+    g->newest = block->older;
+}
+
+
+static void gfrag_touch(struct gfrag_aux* g, int slot)
+/* makes a slot the most recently used */
+{
+  if (g->newest == slot)
     return;
+  gfrag_unlink(g, slot);
+  g->blocks[slot].older = g->newest;
+  g->blocks[slot].newer = -1;
+  if (g->newest != -1)
+    g->blocks[g->newest].newer = slot;
+  g->newest = slot;
+  if (g->oldest == -1)
+    g->oldest = slot;
+}
 
-  sock_fputs(raa_current_db, "acnucclose\n");
 
-  reponse = read_sock(raa_current_db);
-  if (reponse != NULL)
+static void gfrag_remove(struct gfrag_aux* g, int slot)
+/* removes a block from the cache, keeping its memory for later use */
+{
+  int* p;
+
+  p = &g->hash[gfrag_hash(g, g->blocks[slot].nseq, g->blocks[slot].index)];
+  while (*p != slot)
+    p = &g->blocks[*p].next;
+  *p = g->blocks[slot].next;
+  gfrag_unlink(g, slot);
+  g->blocks[slot].nseq = 0;
+  g->blocks[slot].lbuf = 0;
+  g->blocks[slot].next = g->free_slot;
+  g->free_slot = slot;
+}
+
+
+static int gfrag_new_slot(struct gfrag_aux* g, int nseq, int index)
+/* puts in cache an empty block, evicting the least recently used one if needed;
+   returns its slot, or -1 if impossible
+ */
+{
+  int slot, h;
+
+  if (g->free_slot == -1)
+  {
+    /* blocks requested ahead and not received yet can't be evicted */
+    slot = g->oldest;
+    while (slot != -1 && !g->blocks[slot].received)
+      slot = g->blocks[slot].newer;
+    if (slot == -1)
+      return -1;
+    gfrag_remove(g, slot);
+  }
+  slot = g->free_slot;
+  if (g->blocks[slot].buffer == NULL)
+  {
+    g->blocks[slot].buffer = (char*)malloc(RAA_GFRAG_BSIZE + 2);
+    if (g->blocks[slot].buffer == NULL)
+      return -1;
+  }
+  g->free_slot = g->blocks[slot].next;
+  g->blocks[slot].nseq = nseq;
+  g->blocks[slot].index = index;
+  g->blocks[slot].lbuf = 0;
+  g->blocks[slot].received = TRUE;
+  h = gfrag_hash(g, nseq, index);
+  g->blocks[slot].next = g->hash[h];
+  g->hash[h] = slot;
+  g->blocks[slot].newer = -1;
+  g->blocks[slot].older = g->newest;
+  if (g->newest != -1)
+    g->blocks[g->newest].newer = slot;
+  g->newest = slot;
+  if (g->oldest == -1)
+    g->oldest = slot;
+  return slot;
+}
+
+
+static int gfrag_store(raa_db_access* raa_current_db, int slot)
+/* reads into slot the reply to a gfrag command; returns FALSE, after removing the block, if it's empty */
+{
+  struct gfrag_aux* g = &raa_current_db->gfrag_data;
+  struct gfrag_block* block = &g->blocks[slot];
+
+  block->lbuf = raa_gfrag_receive(raa_current_db, block->buffer, RAA_GFRAG_BSIZE);
+  block->received = TRUE;
+  if (block->lbuf == 0)
   {
-    sock_fputs(raa_current_db, "quit\n");
-    sock_flush(raa_current_db);
+    gfrag_remove(g, slot);
+    return FALSE;
   }
-#ifdef WIN32
-  closesocket( (SOCKET) (raa_current_db->raa_sockfdw) );
-#else
-  fclose(raa_current_db->raa_sockfdr);
-  fclose(raa_current_db->raa_sockfdw);
+  if (block->lbuf < RAA_GFRAG_BSIZE)
+  {
+    g->end_nseq = block->nseq;
+    g->end_length = block->index * RAA_GFRAG_BSIZE + block->lbuf;
+  }
+  return TRUE;
+}
+
+
+static void gfrag_receive_ahead(raa_db_access* raa_current_db)
+/* reads the reply to the oldest block requested ahead and not received yet */
+{
+  struct gfrag_aux* g = &raa_current_db->gfrag_data;
+  int slot;
+
+  slot = g->pending[g->pending_first];
+  g->pending_first = (g->pending_first + 1) % RAA_GFRAG_MAXAHEAD;
+  g->ahead_pending--;
+  g->draining = TRUE;
+  gfrag_store(raa_current_db, slot);
+  g->draining = FALSE;
+}
+
+
+static void gfrag_drain_ahead(raa_db_access* raa_current_db)
+{
+  while (raa_current_db->gfrag_data.ahead_pending > 0)
+    gfrag_receive_ahead(raa_current_db);
+}
+
+
+static void gfrag_request_ahead(raa_db_access* raa_current_db, int nsub, int from, int to)
+/* requests blocks of indices from to to of sequence nsub that are not in cache */
+{
+  struct gfrag_aux* g = &raa_current_db->gfrag_data;
+  int index, slot, sent = FALSE;
+
+  for (index = from; index <= to && g->ahead_pending < RAA_GFRAG_MAXAHEAD; index++)
+  {
+    if (nsub == g->end_nseq && index * RAA_GFRAG_BSIZE >= g->end_length)
+      break;
+    if (gfrag_find(g, nsub, index) != -1)
+      continue;
+    slot = gfrag_new_slot(g, nsub, index);
+    if (slot == -1)
+      break;
+    g->blocks[slot].received = FALSE;
+    raa_gfrag_send(raa_current_db, nsub, index * RAA_GFRAG_BSIZE + 1, RAA_GFRAG_BSIZE);
+    g->pending[(g->pending_first + g->ahead_pending) % RAA_GFRAG_MAXAHEAD] = slot;
+    g->ahead_pending++;
+    sent = TRUE;
+  }
+  if (sent)
+    sock_flush(raa_current_db);
+}
+
+
+static int gfrag_get_block(raa_db_access* raa_current_db, int nsub, int index)
+/* returns the cache slot containing a block of sequence data, getting it from server if needed,
+   or -1 if the block is empty or impossible to get
+ */
+{
+  struct gfrag_aux* g = &raa_current_db->gfrag_data;
+  int slot, sequential, i, present;
+
+  sequential = (nsub == g->last_nseq && index == g->last_index + 1);
+  slot = gfrag_find(g, nsub, index);
+  if (slot == -1 && sequential && g->ahead > 0)
+  {
+    /* start read-ahead with the block needed now */
+    gfrag_request_ahead(raa_current_db, nsub, index, index + g->ahead);
+    slot = gfrag_find(g, nsub, index);
+  }
+  if (slot == -1)
+  {
+    slot = gfrag_new_slot(g, nsub, index);
+    if (slot == -1)
+    {
+      gfrag_drain_ahead(raa_current_db);
+      slot = gfrag_new_slot(g, nsub, index);
+      if (slot == -1)
+        return -1;
+    }
+    raa_gfrag_send(raa_current_db, nsub, index * RAA_GFRAG_BSIZE + 1, RAA_GFRAG_BSIZE);
+    if (!gfrag_store(raa_current_db, slot))
+      return -1;
+  }
+  else if (sequential && g->ahead > 0)
+  {
+    /* keep read-ahead going, requesting blocks by groups;
+       the block needed now is made most recent first so that no request evicts it */
+    gfrag_touch(g, slot);
+    present = 0;
+    for (i = index + 1; i <= index + g->ahead; i++)
+    {
+      if (gfrag_find(g, nsub, i) != -1)
+        present++;
+    }
+    if (present <= g->ahead / 2)
+      gfrag_request_ahead(raa_current_db, nsub, index + 1, index + g->ahead);
+  }
+  while (!g->blocks[slot].received)
+    gfrag_receive_ahead(raa_current_db);
+  if (g->blocks[slot].lbuf == 0)
+    return -1; /* was removed because empty */
+  gfrag_touch(g, slot);
+  g->last_nseq = nsub;
+  g->last_index = index;
+  return slot;
+}
+
+
+void raa_gfrag_set_ahead(raa_db_access* raa_current_db, int blocks)
+/* sets to blocks (at most RAA_GFRAG_MAXAHEAD) the number of blocks read ahead
+   when raa_gfrag is called for successive parts of a sequence, 0 to stop read-ahead
+ */
+{
+  if (raa_current_db == NULL)
+    return;
+  if (blocks < 0)
+    blocks = 0;
+  if (blocks > RAA_GFRAG_MAXAHEAD)
+    blocks = RAA_GFRAG_MAXAHEAD;
+  gfrag_drain_ahead(raa_current_db);
+  raa_current_db->gfrag_data.ahead = blocks;
+}
+
+
+void raa_gfrag_clear(raa_db_access* raa_current_db)
+/* empties the sequence block cache and frees its memory */
+{
+  struct gfrag_aux* g;
+  int i;
+
+  if (raa_current_db == NULL)
+    return;
+  g = &raa_current_db->gfrag_data;
+  gfrag_drain_ahead(raa_current_db);
+  if (g->blocks == NULL)
+    return;
+  for (i = 0; i < g->max_blocks; i++)
+  {
+    if (g->blocks[i].buffer != NULL)
+      free(g->blocks[i].buffer);
+  }
+  free(g->blocks);
+  free(g->hash);
+  g->blocks = NULL;
+  g->hash = NULL;
+}
+
+
+void raa_gfrag_set_budget(raa_db_access* raa_current_db, size_t bytes)
+/* sets the memory size of the sequence block cache (0 for default);
+   it holds at least RAA_GFRAG_MAXAHEAD + 2 blocks
+ */
+{
+  if (raa_current_db == NULL)
+    return;
+  raa_gfrag_clear(raa_current_db);
+  raa_current_db->gfrag_data.budget = bytes;
+}
+
+
+int raa_gfrag(raa_db_access* raa_current_db, int nsub, int first, int lfrag, char* dseq)
+{
+  struct gfrag_aux* g;
+  struct gfrag_block* block;
+  int lu, piece, pos, slot;
+
+  if (raa_current_db == NULL || gfrag_init(raa_current_db) != 0)
+    return 0;
+  g = &raa_current_db->gfrag_data;
+  lu = 0;
+  while (lu < lfrag && first >= 1)
+  {
+    pos = first + lu;
+    if (nsub == g->end_nseq && pos > g->end_length)
+      break;
+    slot = gfrag_get_block(raa_current_db, nsub, (pos - 1) / RAA_GFRAG_BSIZE);
+    if (slot == -1)
+      break;
+    block = &g->blocks[slot];
+    if ((pos - 1) % RAA_GFRAG_BSIZE >= block->lbuf)
+      break;
+    piece = block->lbuf - (pos - 1) % RAA_GFRAG_BSIZE;
+    if (piece > lfrag - lu)
+      piece = lfrag - lu;
+    memcpy(dseq + lu, block->buffer + (pos - 1) % RAA_GFRAG_BSIZE, piece);
+    lu += piece;
+    if (block->lbuf < RAA_GFRAG_BSIZE)
+      break;
+  }
+  dseq[lu] = 0;
+  return lu;
+}
+
+
+void raa_acnucclose(raa_db_access* raa_current_db)
+{
+  char* reponse;
+  int i;
+
+  if (raa_current_db == NULL)
+    return;
+
+  raa_zlib_close(raa_current_db);
+  sock_fputs(raa_current_db, "acnucclose\n");
+
+  reponse = read_sock(raa_current_db);
+  if (reponse != NULL)
+  {
+    sock_fputs(raa_current_db, "quit\n");
+    sock_flush(raa_current_db);
+  }
+#ifdef WIN32
+  closesocket(RAA_SOCK_FD(raa_current_db));
+#else
+  close(RAA_SOCK_FD(raa_current_db));
 #endif
 
   if (raa_current_db->tot_key_annots > 0)
@@ -788,19 +1233,15 @@ void raa_acnucclose(raa_db_access* raa_current_db)
     free(raa_current_db->want_key_annots);
     raa_current_db->tot_key_annots = 0;
   }
-  if (raa_current_db->tid_to_rank != NULL)
-    free(raa_current_db->tid_to_rank);
-  if (raa_current_db->sp_tree != NULL)
-  {
-    raa_free_sp_tree(raa_current_db->sp_tree[2]);
-    free(raa_current_db->sp_tree);
-  }
+  raa_free_taxonomy(raa_current_db);
   if (raa_current_db->dbname != NULL)
     free(raa_current_db->dbname);
   if (raa_current_db->rlng_buffer != NULL)
     free(raa_current_db->rlng_buffer);
   if (raa_current_db->readsub_data.name != NULL)
     free(raa_current_db->readsub_data.name);
+  if (raa_current_db->readshrt_data.table != NULL)
+    free(raa_current_db->readshrt_data.table);
   for (i = 0; i < raa_current_db->annot_data.annotcount; i++)
   {
     free(raa_current_db->annot_data.annotline[i]);
@@ -824,8 +1265,14 @@ void raa_acnucclose(raa_db_access* raa_current_db)
     raa_current_db->readsmj_data.lastrec = 0;
   }
   raa_free_matchkeys(raa_current_db);
-  if (raa_current_db->full_line)
-    free(raa_current_db->full_line);
+  raa_gfrag_clear(raa_current_db);
+  /* an outstanding request belongs to its caller and is just forgotten */
+  if (raa_current_db->elt_prefetch.outstanding != NULL)
+    raa_current_db->elt_prefetch.outstanding->pending = 0;
+  if (raa_current_db->sock_input)
+    free(raa_current_db->sock_input);
+  if (raa_current_db->sock_output)
+    free(raa_current_db->sock_output);
   if (raa_current_db->namestr)
     free(raa_current_db->namestr);
   if (raa_current_db->help)
@@ -912,6 +1359,7 @@ static char* raa_requete_remote_file(raa_db_access* raa_current_db, char* oldreq
 
 int raa_proc_query(raa_db_access* raa_current_db, char* requete, char** message,
     char* nomliste, int* numlist, int* count, int* locus, int* type)
+/* nomliste: name of the resulting list, or NULL to let the server give it a name not in use */
 {
   char* reponse, * code, * numlistchr, * countchr, * locuschr, * typechr, * badfname, * p;
   int codret, * tmp_blists;
@@ -931,7 +1379,10 @@ int raa_proc_query(raa_db_access* raa_current_db, char* requete, char** message,
     return 1;
   }
   p = protect_quotes(requete);
-  sock_printf(raa_current_db, "proc_query&query=\"%s\"&name=\"%s\"\n", p, nomliste);
+  if (nomliste == NULL)
+    sock_printf(raa_current_db, "proc_query&query=\"%s\"\n", p);
+  else
+    sock_printf(raa_current_db, "proc_query&query=\"%s\"&name=\"%s\"\n", p, nomliste);
   free(p);
   free(requete);
   reponse = read_sock(raa_current_db);
@@ -996,7 +1447,7 @@ int raa_nexteltinlist_annots(raa_db_access* raa_current_db, int first, int lrank
 {
   int num, next, count;
   char* p;
-  Reponse* rep;
+  Fields f;
 
   if (raa_current_db == NULL)
     return 0;
@@ -1036,38 +1487,20 @@ int raa_nexteltinlist_annots(raa_db_access* raa_current_db, int first, int lrank
     p = read_sock(raa_current_db);
     if (p == NULL)
       return 0;
-    rep = initreponse();
-    parse(p, rep);
-    p = val(rep, "next");
-    if (p == NULL)
-    {
-      clear_reponse(rep);
+    parse_fields(p, &f);
+    next = field_int(&f, "next", -1);
+    if (next == -1)
       return 0;
-    }
-    next = atoi(p);
-    free(p);
     raa_current_db->nextelt_data.total++;
     raa_current_db->nextelt_data.tabnum[num] = next;
     if (next != 0)
     {
-      raa_current_db->nextelt_data.tabname[num] = val(rep, "name");
-      if ( (p = val(rep, "length")) != NULL)
-      {
-        raa_current_db->nextelt_data.tablength[num] = atoi(p);
-        free(p);
-      }
-      if ((p = val(rep, "offset")) != NULL)
-      {
-        raa_current_db->nextelt_data.taboffset[num] = scan_raa_long(p);
-        free(p);
-      }
-      if ((p = val(rep, "div")) != NULL)
-      {
-        raa_current_db->nextelt_data.tabdiv[num] = atoi(p);
-        free(p);
-      }
+      p = field_str(&f, "name");
+      raa_current_db->nextelt_data.tabname[num] = (p == NULL ? NULL : strdup(p));
+      raa_current_db->nextelt_data.tablength[num] = field_int(&f, "length", 0);
+      raa_current_db->nextelt_data.taboffset[num] = field_long(&f, "offset", 0);
+      raa_current_db->nextelt_data.tabdiv[num] = field_int(&f, "div", 0);
     }
-    clear_reponse(rep);
     num++;
   }
   while (next != 0 && --count > 0);
@@ -1076,6 +1509,251 @@ int raa_nexteltinlist_annots(raa_db_access* raa_current_db, int first, int lrank
 }
 
 
+int raa_nexteltinlist_multiple(raa_db_access* raa_current_db, int first, int lrank, int count, int* ranks)
+/* puts in ranks the ranks of at most count elements of list lrank following element first
+   (first = 1 to start from the list beginning), obtained by a single exchange with the server
+   return value: number of ranks put in ranks, < count at end of list, -1 if error
+ */
+{
+  int num, next;
+  char* p;
+
+  if (raa_current_db == NULL || count <= 0)
+    return -1;
+  sock_printf(raa_current_db, "nexteltinlist&lrank=%d&first=%d&count=%d\n", lrank, first, count);
+  num = 0;
+  do
+  {
+    p = read_sock(raa_current_db);
+    if (p == NULL || strncmp(p, "next=", 5) != 0)
+      return -1;
+    next = atoi(p + 5);
+    if (next != 0)
+      ranks[num++] = next;
+  }
+  while (next != 0 && num < count);
+  return num;
+}
+
+
+static int elt_block_reserve(struct raa_elt_block* block, int count, size_t lname)
+/* makes room for count more elements and lname more bytes of names; returns 0 if ok */
+{
+  int size;
+  size_t nsize;
+  void* p;
+
+  if (block->count + count > block->size)
+  {
+    size = 2 * block->size;
+    if (size < block->count + count)
+      size = block->count + count;
+    if ((p = realloc(block->ranks, size * sizeof(int))) == NULL)
+      return -1;
+    block->ranks = (int*)p;
+    if ((p = realloc(block->lengths, size * sizeof(int))) == NULL)
+      return -1;
+    block->lengths = (int*)p;
+    if ((p = realloc(block->divs, size * sizeof(int))) == NULL)
+      return -1;
+    block->divs = (int*)p;
+    if ((p = realloc(block->offsets, size * sizeof(raa_long))) == NULL)
+      return -1;
+    block->offsets = (raa_long*)p;
+    if ((p = realloc(block->name_pos, size * sizeof(size_t))) == NULL)
+      return -1;
+    block->name_pos = (size_t*)p;
+    block->size = size;
+  }
+  if (block->lnames + lname > block->names_size)
+  {
+    nsize = 2 * block->names_size;
+    if (nsize < block->lnames + lname)
+      nsize = block->lnames + lname + 1000;
+    if ((p = realloc(block->names, nsize)) == NULL)
+      return -1;
+    block->names = (char*)p;
+    block->names_size = nsize;
+  }
+  return 0;
+}
+
+
+static int read_elt_block(raa_db_access* raa_current_db, struct raa_elt_block* block, int count)
+/* reads the reply to a nexteltinlist command for count elements and appends them to block;
+   returns the number of elements read, -1 if error
+ */
+{
+  int num, next;
+  size_t l;
+  char* p;
+  Fields f;
+
+  num = 0;
+  block->last = FALSE;
+  do
+  {
+    p = read_sock(raa_current_db);
+    if (p == NULL)
+      return -1;
+    parse_fields(p, &f);
+    next = field_int(&f, "next", -1);
+    if (next == -1)
+      return -1;
+    if (next == 0)
+      block->last = TRUE;
+    else
+    {
+      p = field_str(&f, "name");
+      l = (p == NULL ? 0 : strlen(p));
+      if (elt_block_reserve(block, 1, l + 1) != 0)
+        return -1;
+      block->ranks[block->count] = next;
+      block->name_pos[block->count] = block->lnames;
+      if (p != NULL)
+        memcpy(block->names + block->lnames, p, l);
+      block->names[block->lnames + l] = 0;
+      block->lnames += l + 1;
+      block->lengths[block->count] = field_int(&f, "length", 0);
+      block->offsets[block->count] = field_long(&f, "offset", 0);
+      block->divs[block->count] = field_int(&f, "div", 0);
+      block->count++;
+      num++;
+    }
+  }
+  while (next != 0 && num < count);
+  return num;
+}
+
+
+static void elt_drain(raa_db_access* raa_current_db)
+/* reads the reply to the outstanding request of raa_elt_block_send and keeps it in the request
+   for raa_elt_block_receive
+ */
+{
+  struct elt_prefetch_aux* e = &raa_current_db->elt_prefetch;
+  struct raa_elt_request* request = e->outstanding;
+
+  if (request == NULL)
+    return;
+  e->outstanding = NULL;
+  e->draining = TRUE;
+  request->stash.count = 0;
+  request->stash.lnames = 0;
+  if (read_elt_block(raa_current_db, &request->stash, request->pending) < 0)
+    request->stash.count = -1;
+  e->draining = FALSE;
+  request->pending = 0;
+  request->stashed = TRUE;
+}
+
+
+void raa_elt_block_send(raa_db_access* raa_current_db, struct raa_elt_request* request, int lrank, int first, int count)
+/* requests the ranks, names, lengths, annotation offsets and divisions of at most count elements
+   of list lrank following element first (first = 1 to start from the list beginning), without waiting
+   for the reply, that must be later read by raa_elt_block_receive with the same request;
+   request: zeroed before first use and ended by raa_elt_request_end; it holds one reply at most:
+   that to a previous use of the same request not read yet is discarded;
+   other commands can be sent meanwhile, including requests of other callers: the reply to an outstanding
+   request is then read and kept in that request
+ */
+{
+  if (raa_current_db == NULL || count <= 0)
+    return;
+  elt_drain(raa_current_db);
+  request->stashed = FALSE;
+  sock_printf(raa_current_db, "nexteltinlist&lrank=%d&first=%d&count=%d\n", lrank, first, count);
+  sock_flush(raa_current_db);
+  request->pending = count;
+  raa_current_db->elt_prefetch.outstanding = request;
+}
+
+
+int raa_elt_block_receive(raa_db_access* raa_current_db, struct raa_elt_request* request, struct raa_elt_block* block,
+    int append)
+/* reads the reply to raa_elt_block_send for request into block (initially zeroed),
+   replacing its content, or appending to it if append is TRUE
+   return value: number of elements read, -1 if error or if request was not sent
+ */
+{
+  struct raa_elt_block tmp;
+  int num, i;
+
+  if (raa_current_db == NULL)
+    return -1;
+  if (!append)
+  {
+    block->count = 0;
+    block->lnames = 0;
+  }
+  if (request->stashed)
+  {
+    request->stashed = FALSE;
+    num = request->stash.count;
+    if (num < 0)
+      return -1;
+    if (block->count == 0)
+    {
+      /* exchange memory with the stash rather than copy */
+      tmp = *block;
+      *block = request->stash;
+      request->stash = tmp;
+      return num;
+    }
+    if (elt_block_reserve(block, num, request->stash.lnames) != 0)
+      return -1;
+    memcpy(block->ranks + block->count, request->stash.ranks, num * sizeof(int));
+    memcpy(block->lengths + block->count, request->stash.lengths, num * sizeof(int));
+    memcpy(block->divs + block->count, request->stash.divs, num * sizeof(int));
+    memcpy(block->offsets + block->count, request->stash.offsets, num * sizeof(raa_long));
+    for (i = 0; i < num; i++)
+      block->name_pos[block->count + i] = request->stash.name_pos[i] + block->lnames;
+    memcpy(block->names + block->lnames, request->stash.names, request->stash.lnames);
+    block->count += num;
+    block->lnames += request->stash.lnames;
+    block->last = request->stash.last;
+    return num;
+  }
+  if (request->pending == 0 || raa_current_db->elt_prefetch.outstanding != request)
+    return -1;
+  num = request->pending;
+  request->pending = 0;
+  raa_current_db->elt_prefetch.outstanding = NULL;
+  raa_current_db->elt_prefetch.draining = TRUE;
+  num = read_elt_block(raa_current_db, block, num);
+  raa_current_db->elt_prefetch.draining = FALSE;
+  return num;
+}
+
+
+void raa_elt_request_end(raa_db_access* raa_current_db, struct raa_elt_request* request)
+/* reads and discards the reply to request if not read yet, and frees its memory */
+{
+  if (raa_current_db != NULL && raa_current_db->elt_prefetch.outstanding == request)
+    elt_drain(raa_current_db);
+  request->pending = 0;
+  request->stashed = FALSE;
+  raa_elt_block_free(&request->stash);
+}
+
+
+void raa_elt_block_free(struct raa_elt_block* block)
+/* frees the memory of a block of list elements and zeroes it */
+{
+  if (block->ranks != NULL)
+  {
+    free(block->ranks);
+    free(block->lengths);
+    free(block->divs);
+    free(block->offsets);
+    free(block->name_pos);
+  }
+  if (block->names != NULL)
+    free(block->names);
+  memset(block, 0, sizeof(struct raa_elt_block));
+}
+
+
 raa_long scan_raa_long(char* txt)
 {
   raa_long val;
@@ -1292,6 +1970,40 @@ void raa_bit0(raa_db_access* raa_current_db, int lrank, int num)
 }
 
 
+int raa_bit_multiple(raa_db_access* raa_current_db, int lrank, const int* nums, int count, int value)
+/* sets (value = TRUE) or clears (value = FALSE) the bits of count elements nums of list lrank
+   commands are sent by groups of RAA_BIT_WINDOW, a group being sent before the replies
+   to the previous one are read, so that the server is never idle
+   return value: 0 if ok, -1 if the connection with server is down
+ */
+{
+  int sent, received, end;
+
+  if (raa_current_db == NULL)
+    return -1;
+  sent = received = 0;
+  while (received < count)
+  {
+    end = sent + RAA_BIT_WINDOW;
+    if (end > count)
+      end = count;
+    while (sent < end)
+    {
+      sock_printf(raa_current_db, "bit%c&lrank=%d&num=%d\n", value ? '1' : '0', lrank, nums[sent++]);
+    }
+    /* keep the last group unanswered while the next one is sent */
+    end = (sent < count ? sent - RAA_BIT_WINDOW : count);
+    while (received < end)
+    {
+      if (read_sock(raa_current_db) == NULL)
+        return -1;
+      received++;
+    }
+  }
+  return 0;
+}
+
+
 int raa_btest(raa_db_access* raa_current_db, int lrank, int num)
 {
   if (raa_current_db == NULL)
@@ -1796,90 +2508,44 @@ char* raa_readsub(raa_db_access* raa_current_db, int num, int* plength, int* pty
 char* raa_readloc(raa_db_access* raa_current_db, int num, int* sub, int* pnuc, int* spec, int* host, int* plref,
     int* molec, int* placc, int* org)
 {
-  Reponse* rep;
+  Fields f;
   char* p, * reponse;
-  int code;
 
   if (raa_current_db == NULL)
     return NULL;
-  rep = initreponse();
   sock_printf(raa_current_db, "readloc&num=%u\n", num);
   reponse = read_sock(raa_current_db);
   if (reponse == NULL)
     return NULL;
-  parse(reponse, rep);
-  p = val(rep, "code");
-  if (p == NULL)
+  parse_fields(reponse, &f);
+  if (field_int(&f, "code", -1) != 0)
     return NULL;
-  code = atoi(p);
-  free(p);
-  if (code == 0)
-  {
-    if (sub != NULL)
-    {
-      p = val(rep, "sub");
-      *sub = atoi_u(p);
-      free(p);
-    }
-    if (pnuc != NULL)
-    {
-      p = val(rep, "pnuc");
-      *pnuc = atoi_u(p);
-      free(p);
-    }
-    if (spec != NULL)
-    {
-      p = val(rep, "spec");
-      *spec = atoi_u(p);
-      free(p);
-    }
-    if (host != NULL)
-    {
-      p = val(rep, "host");
-      *host = atoi_u(p);
-      free(p);
-    }
-    if (plref != NULL)
-    {
-      p = val(rep, "plref");
-      *plref = atoi_u(p);
-      free(p);
-    }
-    if (molec != NULL)
-    {
-      p = val(rep, "molec");
-      *molec = atoi_u(p);
-      free(p);
-    }
-    if (placc != NULL)
-    {
-      p = val(rep, "placc");
-      *placc = atoi_u(p);
-      free(p);
-    }
-    if (org != NULL)
-    {
-      p = val(rep, "org");
-      *org = atoi_u(p);
-      free(p);
-    }
-    p = val(rep, "date");
-    strcpy(raa_current_db->date, p);
-    free(p);
-    p = raa_current_db->date;
-  }
-  else
-    p = NULL;
-  clear_reponse(rep);
-  return p;
+  if (sub != NULL)
+    *sub = field_int(&f, "sub", 0);
+  if (pnuc != NULL)
+    *pnuc = field_int(&f, "pnuc", 0);
+  if (spec != NULL)
+    *spec = field_int(&f, "spec", 0);
+  if (host != NULL)
+    *host = field_int(&f, "host", 0);
+  if (plref != NULL)
+    *plref = field_int(&f, "plref", 0);
+  if (molec != NULL)
+    *molec = field_int(&f, "molec", 0);
+  if (placc != NULL)
+    *placc = field_int(&f, "placc", 0);
+  if (org != NULL)
+    *org = field_int(&f, "org", 0);
+  p = field_str(&f, "date");
+  strcpy(raa_current_db->date, p != NULL ? p : "");
+  return raa_current_db->date;
 }
 
 
 char* raa_readspec(raa_db_access* raa_current_db, int num, char** plibel, int* plsub, int* pdesc, int* psyno, int* plhost)
 {
-  Reponse* rep;
+  Fields f;
   char* p, * reponse;
-  int code;
 
   if (raa_current_db == NULL)
     return NULL;
@@ -1903,57 +2569,31 @@ char* raa_readspec(raa_db_access* raa_current_db, int num, char** plibel, int* p
     return raa_current_db->readspec_data.name;
   }
 
-  rep = initreponse();
   sock_printf(raa_current_db, "readspec&num=%u\n", num);
   reponse = read_sock(raa_current_db);
   if (reponse == NULL)
     return NULL;
-  parse(reponse, rep);
-  p = val(rep, "code");
-  if (p == NULL)
+  parse_fields(reponse, &f);
+  if (field_int(&f, "code", -1) != 0)
     return NULL;
-  code = atoi(p);
-  free(p);
-  if (code != 0)
-  {
-    clear_reponse(rep);
-    return NULL;
-  }
 
   raa_current_db->readspec_data.previous = num;
-  p = val(rep, "plsub");
-  raa_current_db->readspec_data.lsub = atoi_u(p);
-  free(p);
-  p = val(rep, "desc");
-  raa_current_db->readspec_data.desc = atoi_u(p);
-  free(p);
-  p = val(rep, "syno");
-  raa_current_db->readspec_data.syno = atoi_u(p);
-  free(p);
-  p = val(rep, "host");
-  raa_current_db->readspec_data.host = atoi_u(p);
-  free(p);
-  p = val(rep, "libel");
-  if (p != NULL)
-  {
-    strcpy(raa_current_db->readspec_data.libel, p);
-    free(p);
-  }
-  else
-    *(raa_current_db->readspec_data.libel) = 0;
-  p = val(rep, "name");
-  strcpy(raa_current_db->readspec_data.name, p );
-  free(p);
-  clear_reponse(rep);
+  raa_current_db->readspec_data.lsub = field_int(&f, "plsub", 0);
+  raa_current_db->readspec_data.desc = field_int(&f, "desc", 0);
+  raa_current_db->readspec_data.syno = field_int(&f, "syno", 0);
+  raa_current_db->readspec_data.host = field_int(&f, "host", 0);
+  p = field_str(&f, "libel");
+  strcpy(raa_current_db->readspec_data.libel, p != NULL ? p : "");
+  p = field_str(&f, "name");
+  strcpy(raa_current_db->readspec_data.name, p != NULL ? p : "");
   return raa_readspec(raa_current_db, num, plibel, plsub, pdesc, psyno, plhost);
 }
 
 
 char* raa_readkey(raa_db_access* raa_current_db, int num, char** plibel, int* plsub, int* pdesc, int* psyno)
 {
-  Reponse* rep;
+  Fields f;
   char* p, * reponse;
-  int code;
 
   if (raa_current_db == NULL)
     return NULL;
@@ -1975,45 +2615,22 @@ char* raa_readkey(raa_db_access* raa_current_db, int num, char** plibel, int* pl
     return raa_current_db->readkey_data.name;
   }
 
-  rep = initreponse();
   sock_printf(raa_current_db, "readkey&num=%u\n", num);
   reponse = read_sock(raa_current_db);
   if (reponse == NULL)
     return NULL;
-  parse(reponse, rep);
-  p = val(rep, "code");
-  if (p == NULL)
-    return NULL;
-  code = atoi(p);
-  free(p);
-  if (code != 0)
-  {
-    clear_reponse(rep);
+  parse_fields(reponse, &f);
+  if (field_int(&f, "code", -1) != 0)
     return NULL;
-  }
 
   raa_current_db->readkey_data.previous = num;
-  p = val(rep, "plsub");
-  raa_current_db->readkey_data.lsub = atoi_u(p);
-  free(p);
-  p = val(rep, "desc");
-  raa_current_db->readkey_data.desc = atoi_u(p);
-  free(p);
-  p = val(rep, "syno");
-  raa_current_db->readkey_data.syno = atoi_u(p);
-  free(p);
-  p = val(rep, "libel");
-  if (p != NULL)
-  {
-    strcpy(raa_current_db->readkey_data.libel, p);
-    free(p);
-  }
-  else
-    *(raa_current_db->readkey_data.libel) = 0;
-  p = val(rep, "name");
-  strcpy(raa_current_db->readkey_data.name, p);
-  free(p);
-  clear_reponse(rep);
+  raa_current_db->readkey_data.lsub = field_int(&f, "plsub", 0);
+  raa_current_db->readkey_data.desc = field_int(&f, "desc", 0);
+  raa_current_db->readkey_data.syno = field_int(&f, "syno", 0);
+  p = field_str(&f, "libel");
+  strcpy(raa_current_db->readkey_data.libel, p != NULL ? p : "");
+  p = field_str(&f, "name");
+  strcpy(raa_current_db->readkey_data.name, p != NULL ? p : "");
   return raa_readkey(raa_current_db, num, plibel, plsub, pdesc, psyno);
 }
 
@@ -2222,14 +2839,64 @@ int raa_readlng(raa_db_access* raa_current_db, int num)
 }
 
 
+static unsigned scan_unsigned(char** pp)
+/* reads the decimal integer at *pp and moves *pp after it and after a following comma */
+{
+  char* p = *pp;
+  unsigned value = 0;
+
+  while (*p >= '0' && *p <= '9')
+    value = 10 * value + (unsigned)(*p++ - '0');
+  if (*p == ',')
+    p++;
+  *pp = p;
+  return value;
+}
+
+
+static struct shrt_record* shrt_slot(struct readshrt_aux* aux, unsigned point)
+/* returns the slot of the hash table holding point, or the free slot where to put it */
+{
+  unsigned h;
+
+  h = point * 2654435761U;
+  h ^= h >> 16;
+  h &= aux->mask;
+  while (aux->table[h].point != 0 && aux->table[h].point != point)
+    h = (h + 1) & aux->mask;
+  return aux->table + h;
+}
+
+
+static int shrt_table_init(struct readshrt_aux* aux)
+/* allocates the hash table with at least twice as many slots as memorized records */
+{
+  unsigned size;
+
+  if (aux->capacity <= 0)
+    aux->capacity = S_BUF_SHRT;
+  else if (aux->capacity < MAX_RDSHRT)
+    aux->capacity = MAX_RDSHRT;
+  size = 16;
+  while (size < 2 * (unsigned)aux->capacity)
+    size *= 2;
+  aux->table = (struct shrt_record*)calloc(size, sizeof(struct shrt_record));
+  if (aux->table == NULL)
+    return 1;
+  aux->mask = size - 1;
+  aux->count = 0;
+  return 0;
+}
+
+
 static void load_shrt_buffer(raa_db_access* raa_current_db, unsigned point)
 {
-  char* reponse, * p, * q;
+  struct readshrt_aux* aux = &raa_current_db->readshrt_data;
+  struct shrt_record* slot;
+  char* reponse, * p;
   int n, i;
   unsigned val, next, previous;
 
-  if (raa_current_db == NULL)
-    return;
   sock_printf(raa_current_db, "readshrt&num=%u&max=%d\n", point, MAX_RDSHRT);
 /* reponse is:  code=0&n=xx&val,next,.... n times ...\n  */
   reponse = read_sock(raa_current_db);
@@ -2238,57 +2905,82 @@ static void load_shrt_buffer(raa_db_access* raa_current_db, unsigned point)
   {
     return;
   }
-  n = atoi(reponse + 9);
-  if (n == 0)
-    return;
-  p = strchr(reponse + 9, '&');
-  if (p == NULL)
+  p = reponse + 9;
+  n = (int)scan_unsigned(&p);
+  if (n == 0 || *p != '&')
     return;
-  q = p + 1;
-  previous = point;
-  for (i = 0; i < n; i++)
+  p++;
+  if (aux->count + n > aux->capacity)
   {
-    p = strtok(q, ",");
-    q = NULL;
-    sscanf(p, "%u", &val);
-    p = strtok(NULL, ",");
-    sscanf(p, "%u", &next);
-    raa_current_db->readshrt_data.shrt_begin = (raa_current_db->readshrt_data.shrt_begin + 1) % S_BUF_SHRT;
-    raa_current_db->readshrt_data.shrt_buffer[raa_current_db->readshrt_data.shrt_begin][0] = previous;
-    raa_current_db->readshrt_data.shrt_buffer[raa_current_db->readshrt_data.shrt_begin][1] = val;
-    raa_current_db->readshrt_data.shrt_buffer[raa_current_db->readshrt_data.shrt_begin][2] = next;
-    previous = next;
+    /* the cache is full: forget all memorized records */
+    memset(aux->table, 0, (aux->mask + 1) * sizeof(struct shrt_record));
+    aux->count = 0;
   }
-  if (raa_current_db->readshrt_data.shrt_begin > raa_current_db->readshrt_data.shrt_max - 1)
+  previous = point;
+  for (i = 0; i < n && *p != 0 && aux->count < aux->capacity; i++)
   {
-    raa_current_db->readshrt_data.shrt_max = raa_current_db->readshrt_data.shrt_begin + 1;
+    val = scan_unsigned(&p);
+    next = scan_unsigned(&p);
+    slot = shrt_slot(aux, previous);
+    if (slot->point == 0)
+    {
+      slot->point = previous;
+      aux->count++;
+    }
+    slot->val = val;
+    slot->next = next;
+    previous = next;
   }
-  return;
 }
 
 
 unsigned raa_readshrt(raa_db_access* raa_current_db, unsigned point, int* pval)
+/* returns the next element of the SHORTL list at point, and puts its value in *pval
+   SHORTL records are memorized in a hash table, and read from server by groups of MAX_RDSHRT
+ */
 {
-  int i;
+  struct readshrt_aux* aux;
+  struct shrt_record* slot;
 
   if (raa_current_db == NULL)
     return 0;
-  if (raa_current_db->readshrt_data.total == 0)
-    raa_current_db->readshrt_data.total = (unsigned)raa_read_first_rec(raa_current_db, raa_shrt);
-  if (point < 2 || point > raa_current_db->readshrt_data.total)
+  aux = &raa_current_db->readshrt_data;
+  if (aux->total == 0)
+    aux->total = (unsigned)raa_read_first_rec(raa_current_db, raa_shrt);
+  if (point < 2 || point > (unsigned)aux->total)
+    return 0;
+  if (aux->table == NULL && shrt_table_init(aux) != 0)
     return 0;
 
-  for (i = 0; i < raa_current_db->readshrt_data.shrt_max; i++)
+  slot = shrt_slot(aux, point);
+  if (slot->point == 0)
   {
-    if (raa_current_db->readshrt_data.shrt_buffer[i][0] == point)
-    {
-      if (pval != NULL)
-        *pval = raa_current_db->readshrt_data.shrt_buffer[i][1];
-      return raa_current_db->readshrt_data.shrt_buffer[i][2];
-    }
+    load_shrt_buffer(raa_current_db, point);
+    slot = shrt_slot(aux, point);
+    if (slot->point == 0)
+      return 0;
+  }
+  if (pval != NULL)
+    *pval = slot->val;
+  return slot->next;
+}
+
+
+void raa_readshrt_set_capacity(raa_db_access* raa_current_db, int records)
+/* sets the number of SHORTL records memorized by raa_readshrt (0 for default) */
+{
+  struct readshrt_aux* aux;
+
+  if (raa_current_db == NULL)
+    return;
+  aux = &raa_current_db->readshrt_data;
+  if (aux->table != NULL)
+  {
+    free(aux->table);
+    aux->table = NULL;
   }
-  load_shrt_buffer(raa_current_db, point);
-  return raa_readshrt(raa_current_db, point, pval);
+  aux->count = 0;
+  aux->capacity = records;
 }
 
 
@@ -2554,6 +3246,39 @@ static char* protect_quotes(char* name)
 }
 
 
+static int read_crelist_reply(raa_db_access* raa_current_db, int* plrank, char** pname)
+/* lit la reponse a crelistfromclientdata
+   retour 0 si ok, -1 si connexion perdue, sinon le code d'erreur
+   *pname: nom de la liste creee alloue par malloc
+ */
+{
+  char* reponse, * q;
+  int code;
+  Reponse* rep;
+
+  reponse = read_sock(raa_current_db);
+  if (reponse == NULL)
+    return -1;
+  rep = initreponse();
+  parse(reponse, rep);
+  q = val(rep, "code");
+  code = atoi(q);
+  free(q);
+  if (code == 0)
+  {
+    *pname = val(rep, "name");
+    q = val(rep, "lrank");
+    if (q != NULL)
+    {
+      *plrank = atoi(q);
+      free(q);
+    }
+  }
+  clear_reponse(rep);
+  return code;
+}
+
+
 static char* prepare_remote_file(raa_db_access* raa_current_db, char* oldrequete, char* debut, char* type, int* plrank,
     char** badfname)
 {
@@ -2561,7 +3286,6 @@ static char* prepare_remote_file(raa_db_access* raa_current_db, char* oldrequete
   char* line = raa_current_db->remote_file;
   int nl, l, code;
   FILE* in;
-  Reponse* rep;
 
   *plrank = 0; *badfname = line;
   p = strchr(debut, '=') + 1;
@@ -2608,26 +3332,17 @@ static char* prepare_remote_file(raa_db_access* raa_current_db, char* oldrequete
   }
   fclose(in);
 
-  reponse = read_sock(raa_current_db);
-  if (reponse == NULL)
-  {
-    strcpy(line, "connection with server is down");
-    return NULL;
-  }
-  rep = initreponse();
-  parse(reponse, rep);
-  q = val(rep, "code");
-  code = atoi(q);
-  free(q);
+  code = read_crelist_reply(raa_current_db, plrank, &q);
   if (code != 0)
   {
-    if (code == 3)
+    if (code == -1)
+      strcpy(line, "connection with server is down");
+    else if (code == 3)
       strcpy(line, "too many lists, delete a few");
     else
       sprintf(line, "code=%d", code);
     return NULL;
   }
-  q = val(rep, "name");
   l = strlen(q);
   reponse = (char*)malloc( (debut - oldrequete) + 1 + l + 1 + strlen(fin) + 1);
   p = reponse;
@@ -2640,15 +3355,40 @@ static char* prepare_remote_file(raa_db_access* raa_current_db, char* oldrequete
   free(q);
   strcpy(p, fin);
   free(oldrequete);
-  q = val(rep, "lrank");
-  if (q != NULL)
+  return reponse;
+}
+
+
+int raa_crelistfromclientdata(raa_db_access* raa_current_db, const char* type, char** items, int count,
+    int* plrank, char** pname)
+/* creates a list from count sequence names (type "SQ"), accession numbers ("AC"), species names ("SP")
+   or keywords ("KW") held in memory, all sent to the server in a single command
+   plrank: set to the rank of the created list
+   pname: NULL, or set to the name given to the list by the server, in memory allocated by malloc
+   return value: 0 if ok, 3 if too many lists, -1 if the connection with server is down, other if error
+ */
+{
+  int i, code;
+  char* name;
+
+  if (raa_current_db == NULL)
+    return -1;
+  *plrank = 0;
+  sock_printf(raa_current_db, "crelistfromclientdata&type=%s&nl=%d\n", type, count);
+  for (i = 0; i < count; i++)
   {
-    *plrank = atoi(q);
-    free(q);
+    sock_fputs(raa_current_db, items[i]);
+    sock_fputs(raa_current_db, "\n");
   }
-
-  clear_reponse(rep);
-  return reponse;
+  code = read_crelist_reply(raa_current_db, plrank, &name);
+  if (code == 0)
+  {
+    if (pname != NULL)
+      *pname = name;
+    else
+      free(name);
+  }
+  return code;
 }
 
 
@@ -2779,8 +3519,8 @@ int raa_savelist(raa_db_access* raa_current_db, int lrank, FILE* out, int use_ac
 int raa_modifylist(raa_db_access* raa_current_db, int lrank, char* type, char* operation, int* pnewlist, int (* check_interrupt)(void),
     int* p_processed )
 {
-  Reponse* rep;
-  char* p, * reponse;
+  Fields f;
+  char* reponse;
   int code;
 
   if (raa_current_db == NULL)
@@ -2811,22 +3551,13 @@ int raa_modifylist(raa_db_access* raa_current_db, int lrank, char* type, char* o
     }
   }
 
-  rep = initreponse();
-  parse(reponse, rep);
-  p = val(rep, "code");
-  code = atoi(p);
-  free(p);
+  parse_fields(reponse, &f);
+  code = field_int(&f, "code", 3);
   if (code != 0)
     return code;
-  p = val(rep, "lrank");
-  *pnewlist = atoi(p);
-  free(p);
-  p = val(rep, "processed");
-  if (p != NULL && p_processed != NULL)
-    *p_processed = atoi(p);
-  if (p != NULL)
-    free(p);
-  clear_reponse(rep);
+  *pnewlist = field_int(&f, "lrank", 0);
+  if (p_processed != NULL)
+    *p_processed = field_int(&f, "processed", *p_processed);
   return 0;
 }
 
@@ -2974,6 +3705,219 @@ char* raa_short_descr(raa_db_access* raa_current_db, int seqnum, char* text, int
 }
 
 
+struct extract_aux
+{
+  raa_db_access* raa_current_db;
+  FILE* out;
+  void (* sink)(const char*, size_t, void*);
+  void* sink_arg;
+  int by_header; /* TRUE when records begin with a '>' line, FALSE when they end with a "//" line */
+  int has_next; /* TRUE when the first line of next record was already read in next */
+  char* next;
+  size_t l_next, max_next;
+  int finished;
+};
+
+
+static void extract_write(struct extract_aux* aux, const char* line, size_t l)
+{
+  if (aux->out != NULL)
+  {
+    fwrite(line, 1, l, aux->out);
+    putc('\n', aux->out);
+  }
+  else if (aux->sink != NULL)
+    aux->sink(line, l, aux->sink_arg);
+}
+
+
+static char* extract_read(struct extract_aux* aux, size_t* pl)
+/* next line of extracted data, or NULL at end of extraction */
+{
+  char* line;
+
+  do
+    line = read_sock_len(aux->raa_current_db, pl);
+  while (line != NULL && *line == 27 /* esc */);
+  if (line == NULL || strcmp(line, "extractseqs END.") == 0)
+  {
+    raa_zlib_close(aux->raa_current_db);
+    aux->finished = TRUE;
+    return NULL;
+  }
+  return line;
+}
+
+
+void* raa_prep_extract(raa_db_access* raa_current_db, char* format, FILE* outstream, char* choix,
+    char* feature_name, char* bornes, char* min_bornes, char** message, int lrank)
+/*
+   prepares the extraction of all sequences of list of rank lrank in one streamed compressed transfer
+   format: "acnuc", "fasta", "flat" or "gcg" (a gcg extraction is written by a single raa_extract_1_seq call)
+   outstream: where extracted data are written, or NULL to use raa_extract_set_sink
+   choix: "simple", "fragment", "feature" or "region" (see raa_prep_coordinates for the other arguments)
+   message: upon return, NULL or an error message (to be freed by caller)
+
+   return value: NULL if error, or pointer to opaque data to be given to raa_extract_1_seq
+   until it returns FALSE, or to raa_extract_interrupt
+ */
+{
+  struct extract_aux* aux;
+  char* line, * p;
+  int l;
+
+  *message = NULL;
+  if (raa_current_db == NULL)
+    return NULL;
+  sock_printf(raa_current_db, "extractseqs&lrank=%d&format=%s&operation=%s", lrank, format, choix);
+  if (strcmp(choix, "feature") == 0 || strcmp(choix, "region") == 0)
+    sock_printf(raa_current_db, "&feature=%s", feature_name);
+  if (strcmp(choix, "fragment") == 0 || strcmp(choix, "region") == 0)
+    sock_printf(raa_current_db, "&bounds=%s", bornes);
+  if (min_bornes != NULL)
+    sock_printf(raa_current_db, "&minbounds=%s", min_bornes);
+  sock_fputs(raa_current_db, "&zlib=T\n");
+  line = read_sock(raa_current_db);
+  if (line == NULL)
+    return NULL;
+  if (strcmp(line, "code=0") != 0)
+  {
+    p = strstr(line, "message=");
+    if (p != NULL)
+    {
+      p += 8;
+      if (*p == '"')
+        p++;
+      *message = strdup(p);
+      l = strlen(*message);
+      if (l > 0 && (*message)[l - 1] == '"')
+        (*message)[l - 1] = 0;
+    }
+    return NULL;
+  }
+  if (raa_zlib_open(raa_current_db) != 0)
+  {
+    *message = strdup("not enough memory");
+    return NULL;
+  }
+  aux = (struct extract_aux*)calloc(1, sizeof(struct extract_aux));
+  if (aux == NULL)
+  {
+    raa_extract_interrupt(raa_current_db, NULL);
+    *message = strdup("not enough memory");
+    return NULL;
+  }
+  aux->raa_current_db = raa_current_db;
+  aux->out = outstream;
+  aux->by_header = (strcmp(format, "fasta") == 0 || strcmp(format, "acnuc") == 0);
+  return aux;
+}
+
+
+void raa_extract_set_sink(void* opaque, void (* sink)(const char* line, size_t l, void* arg), void* arg)
+/* when raa_prep_extract was called with a NULL outstream, extracted lines of length l
+   (without \n) are given to this function
+ */
+{
+  struct extract_aux* aux = (struct extract_aux*)opaque;
+
+  aux->sink = sink;
+  aux->sink_arg = arg;
+}
+
+
+int raa_extract_1_seq(void* opaque, char** message)
+/* writes one more extracted sequence and returns TRUE,
+   or returns FALSE when all sequences have been written, after having freed opaque;
+   also returns FALSE, after having stopped the extraction and freed opaque, if the next record
+   could not be kept in memory: message, unless NULL, then receives an error message
+   (to be freed by caller), and NULL otherwise
+   gcg records are not delimited in the extracted data: the first call writes them all
+ */
+{
+  struct extract_aux* aux = (struct extract_aux*)opaque;
+  char* line, * p;
+  size_t l;
+
+  if (message != NULL)
+    *message = NULL;
+  if (aux->has_next)
+  {
+    extract_write(aux, aux->next, aux->l_next);
+    aux->has_next = FALSE;
+  }
+  else
+  {
+    line = aux->finished ? NULL : extract_read(aux, &l);
+    if (line == NULL)
+    {
+      if (aux->next != NULL)
+        free(aux->next);
+      free(aux);
+      return FALSE;
+    }
+    extract_write(aux, line, l);
+  }
+  while ( (line = extract_read(aux, &l)) != NULL)
+  {
+    if (aux->by_header && *line == '>')
+    {
+      /* keep this header for next call */
+      if (l + 1 > aux->max_next)
+      {
+        p = (char*)realloc(aux->next, l + 100);
+        if (p == NULL)
+        { /* the header of next record would be lost */
+          raa_extract_interrupt(aux->raa_current_db, aux);
+          if (message != NULL)
+            *message = strdup("not enough memory");
+          return FALSE;
+        }
+        aux->next = p;
+        aux->max_next = l + 100;
+      }
+      memcpy(aux->next, line, l + 1);
+      aux->l_next = l;
+      aux->has_next = TRUE;
+      break;
+    }
+    extract_write(aux, line, l);
+    if ((!aux->by_header) && strcmp(line, "//") == 0)
+      break;
+  }
+  return TRUE;
+}
+
+
+int raa_extract_interrupt(raa_db_access* raa_current_db, void* opaque)
+/* stops an extraction prepared by raa_prep_extract and frees opaque; returns 0 iff OK */
+{
+  struct extract_aux* aux = (struct extract_aux*)opaque;
+  char* line;
+
+  if (raa_current_db == NULL)
+    return 1;
+  if (aux == NULL || !aux->finished)
+  {
+    sock_fputs(raa_current_db, "\033" /* esc */);
+    sock_flush(raa_current_db);
+    do
+      line = read_sock(raa_current_db);
+    while (line != NULL && strcmp(line, "extractseqs END.") != 0);
+    raa_zlib_close(raa_current_db);
+  }
+  if (aux != NULL)
+  {
+    if (aux->next != NULL)
+      free(aux->next);
+    free(aux);
+  }
+  /* just to consume ESC that may have arrived after extractseqs END. */
+  sock_fputs(raa_current_db, "null_command\n");
+  return read_sock(raa_current_db) == NULL;
+}
+
+
 #define END_COORDINATE_TEST(line) strncmp(line, "extractseqs END.", 16)
 
 static int* next_1_coordinate_set(raa_db_access* raa_current_db)
@@ -3077,12 +4021,14 @@ void* raa_prep_coordinates(raa_db_access* raa_current_db, int lrank, int seqnum,
     sprintf(message, "&minbounds=%s", min_bounds);
     sock_fputs(raa_current_db, message);
   }
-  sock_fputs(raa_current_db, "\n"); sock_flush(raa_current_db);
+  sock_printf(raa_current_db, "&zlib=%c\n", raa_current_db->zlib_replies ? 'T' : 'F');
   line = read_sock(raa_current_db);
-  if (strcmp(line, "code=0") != 0)
+  if (line == NULL || strcmp(line, "code=0") != 0)
   {
     return NULL;
   }
+  if (raa_current_db->zlib_replies)
+    raa_zlib_open(raa_current_db);
 
   maxi = 100; rank = 0;
   table = (int**)malloc(maxi * sizeof(int*));
@@ -3091,6 +4037,7 @@ void* raa_prep_coordinates(raa_db_access* raa_current_db, int lrank, int seqnum,
     do
       line = read_sock(raa_current_db);
     while (END_COORDINATE_TEST(line) != 0);
+    raa_zlib_close(raa_current_db);
     return NULL;
   }
   while ( (v = next_1_coordinate_set(raa_current_db)) != NULL)
@@ -3111,6 +4058,7 @@ void* raa_prep_coordinates(raa_db_access* raa_current_db, int lrank, int seqnum,
     }
     table[rank++] = v;
   }
+  raa_zlib_close(raa_current_db);
   table = realloc(table, rank * sizeof(int*));
   retval = (struct coord_series_struct*)malloc(sizeof(struct coord_series_struct));
   if (retval == NULL)
@@ -3160,61 +4108,105 @@ int* raa_1_coordinate_set(void* v)
 }
 
 
+static void translate_codons(const char* cds, int naa, int gc, int special_init, char* out)
+/* traduit naa codons consecutifs de cds dans out (qui peut etre egal a cds), codon initiateur
+   traite si special_init, * internes ==> X
+ */
+{
+  char init_aa = 0, * p;
+
+  if (naa > 0 && special_init) /* lu avant que out ne soit ecrit quand out == cds */
+    init_aa = init_codon_to_aa((char*)cds, gc);
+  translate_nucleotides(cds, 3 * (size_t)naa, gc, out);
+  if (init_aa != 0)
+    out[0] = init_aa;
+  out[naa] = 0;
+  p = out;
+  while (naa > 1 && (p = (char*)memchr(p, '*', out + naa - 1 - p)) != NULL)
+    *p = 'X';
+}
+
+
+static int cds_is_5_partial(raa_db_access* raa_current_db, int point)
+/* TRUE ssi la liste de mots-cles commencant en point contient 5'-PARTIAL */
+{
+  int val, rank = 0;
+
+  if (raa_current_db->num_5_partial == 0)
+    raa_current_db->num_5_partial = raa_iknum(raa_current_db, "5'-PARTIAL", raa_key);
+  while (point != 0)
+  {
+    val = raa_followshrt2(raa_current_db, &point, &rank, raa_key_of_sub);
+    if (val == raa_current_db->num_5_partial)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+
 char* raa_translate_cds(raa_db_access* raa_current_db, int seqnum)
 /* traduction d'un cds avec codon initiateur traite et * internes ==> X
    rendue dans memoire allouee ici qu'il ne faut pas modifier
    retour NULL si pb lecture de la seq
+   le cds est lu en un seul appel a raa_gfrag puis traduit sur place
  */
 {
-  int debut_codon, longueur, pos, code, phase;
-  char codon[4], * p;
+  int longueur, naa, point, code, phase, special_init;
+  char* buffer;
 
-  raa_readsub(raa_current_db, seqnum, &longueur, NULL, NULL, NULL, NULL, &phase, &code);
-  debut_codon = phase + 1;
-  longueur = (longueur - debut_codon + 1) / 3;
-  raa_current_db->translate_buffer = (char*)realloc(raa_current_db->translate_buffer, longueur + 1);
-  if (raa_current_db->translate_buffer == NULL)
+  raa_readsub(raa_current_db, seqnum, &longueur, NULL, NULL, &point, NULL, &phase, &code);
+  naa = (longueur - phase) / 3;
+  if (naa < 0)
+    naa = 0;
+  buffer = (char*)realloc(raa_current_db->translate_buffer, 3 * naa + 1);
+  if (buffer == NULL)
   {
     return NULL;
   }
-  raa_current_db->translate_buffer[0] = raa_translate_init_codon(raa_current_db, seqnum);
-  debut_codon += 3;
-  for (pos = 1; pos < longueur; pos++)
+  raa_current_db->translate_buffer = buffer;
+  special_init = (phase == 0 && !cds_is_5_partial(raa_current_db, point));
+  if (naa > 0)
   {
-    if (raa_gfrag(raa_current_db, seqnum, debut_codon, 3, codon) == 0)
+    longueur = raa_gfrag(raa_current_db, seqnum, phase + 1, 3 * naa, buffer);
+    if (longueur == 0)
       return NULL;
-    raa_current_db->translate_buffer[pos] = codaa(codon, code);
-    debut_codon += 3;
+    naa = longueur / 3;
   }
-  raa_current_db->translate_buffer[longueur] = 0;
-  while ( (p = strchr(raa_current_db->translate_buffer, '*') ) != NULL && p - raa_current_db->translate_buffer < longueur - 1)
-    *p = 'X';
-  return raa_current_db->translate_buffer;
+  translate_codons(buffer, naa, code, special_init, buffer);
+  return buffer;
+}
+
+
+char* raa_translate_cds_seq(raa_db_access* raa_current_db, const char* cds, int length, int gc, int special_init)
+/* traduction de length nucleotides de cds commencant par le premier codon,
+   avec codon initiateur traite si special_init et * internes ==> X
+   rendue dans memoire allouee ici qu'il ne faut pas modifier
+   retour NULL si pas assez de memoire
+ */
+{
+  int naa;
+  char* buffer;
+
+  naa = length > 0 ? length / 3 : 0;
+  buffer = (char*)realloc(raa_current_db->translate_buffer, naa + 1);
+  if (buffer == NULL)
+  {
+    return NULL;
+  }
+  raa_current_db->translate_buffer = buffer;
+  translate_codons(cds, naa, gc, special_init, buffer);
+  return buffer;
 }
 
 
 char raa_translate_init_codon(raa_db_access* raa_current_db, int numseq)
 {
   char codon[4];
-  int point, special_init = TRUE, val, gc = 0, phase = 0, rank = 0;
+  int point, special_init, gc = 0, phase = 0;
 
-  if (raa_current_db->num_5_partial == 0)
-    raa_current_db->num_5_partial = raa_iknum(raa_current_db, "5'-PARTIAL", raa_key);
   raa_readsub(raa_current_db, numseq, NULL, NULL, NULL, &point, NULL, &phase, &gc);
-  if (phase != 0)
-    special_init = FALSE;
-  else    /* la seq est-elle 5'-PARTIAL ? */
-  {
-    while (point != 0)
-    {
-      val = raa_followshrt2(raa_current_db, &point, &rank, raa_key_of_sub);
-      if (val == raa_current_db->num_5_partial)
-      {
-        special_init = FALSE;
-        break;
-      }
-    }
-  }
+  /* pas de traduction speciale si phase != 0 ou si la seq est 5'-PARTIAL */
+  special_init = (phase == 0 && !cds_is_5_partial(raa_current_db, point));
   raa_gfrag(raa_current_db, numseq, phase + 1, 3, codon);
   if (special_init) /* traduction speciale du codon initiateur */
     return init_codon_to_aa(codon, gc);
@@ -3223,77 +4215,99 @@ char raa_translate_init_codon(raa_db_access* raa_current_db, int numseq)
 }
 
 
-static void ajout_synonyme(raa_node* secondaire, raa_node* principal)
+static void ajout_synonyme(raa_sp_tree* tree, int secondaire, int principal)
 {
-  raa_node* next;
-
-  if (principal->syno == NULL)
+  if (tree->syno[principal] == 0)
   {
-    principal->syno = secondaire;
-    secondaire->syno = principal;
+    tree->syno[principal] = secondaire;
+    tree->syno[secondaire] = principal;
   }
   else
   {
-    next = principal->syno;
-    principal->syno = secondaire;
-    secondaire->syno = next;
+    tree->syno[secondaire] = tree->syno[principal];
+    tree->syno[principal] = secondaire;
   }
 }
 
-static void redresse_branches(raa_node* pere)
-/* Recursively reverse the order of descendants because it has been reversed
+
+static void ajout_branche(raa_sp_tree* tree, int* last_child, int pere, int fils)
+/* adds a pere->fils branch after the other descendants of pere
  */
 {
-  struct raa_pair* point, * next1, * next2, * last;
-  point = pere->list_desc;
-  if (!point)
-    return;
-  next1 = point->next;
-  if (next1)
-    point->next = NULL;
-  while (TRUE)
-  {
-    last = point;
-    redresse_branches(point->value);
-    if (!next1)
-      break;
-    next2 = next1->next;
-    next1->next = point;
-    point = next1;
-    next1 = next2;
-  }
-  pere->list_desc = last;
+  if (last_child[pere] == 0)
+    tree->first_child[pere] = fils;
+  else
+    tree->next_sibling[last_child[pere]] = fils;
+  last_child[pere] = fils;
 }
 
 
-static void ajout_branche(raa_node* pere, raa_node* fils)
-/* adds a pere->fils branch. The last added branch is the first child of pere.
+static unsigned sp_tree_add_string(raa_sp_tree* tree, const char* s, size_t l)
+/* appends to the string pool the l chars of s, a "..." string with protected inner quotes;
+   returns the position of the unprotected string in the pool, 0 if error
  */
 {
-  struct raa_pair* nouveau;
+  size_t pos, nsize;
+  char* p;
+
+  if (tree->lstrings + l + 1 > tree->strings_size)
+  {
+    nsize = 2 * tree->strings_size;
+    if (nsize < tree->lstrings + l + 1)
+      nsize = tree->lstrings + l + 1000;
+    p = (char*)realloc(tree->strings, nsize);
+    if (p == NULL)
+      return 0;
+    tree->strings = p;
+    tree->strings_size = nsize;
+  }
+  pos = tree->lstrings;
+  memcpy(tree->strings + pos, s, l);
+  tree->strings[pos + l] = 0;
+  unprotect_quotes(tree->strings + pos);
+  tree->lstrings = pos + strlen(tree->strings + pos) + 1;
+  return (unsigned)pos;
+}
+
 
-  nouveau = (struct raa_pair*)calloc(1, sizeof(struct raa_pair));
-  nouveau->value = fils;
-  if (pere->list_desc == NULL)
+static char* end_quoted(char* p)
+/* p points to the opening quote of a "..." string; returns the address of its closing quote
+   or of the string end
+ */
+{
+  do
   {
-    pere->list_desc = nouveau;
+    p++;
+    if (*p == 0)
+      break;
   }
-  else
+  while (*p != '"' || *(p - 1) == '\\');
+  return p;
+}
+
+
+static int label_tid(const char* libel)
+/* returns the taxon ID written as ID:xxx at start of label or after a |, 0 if none */
+{
+  const char* p;
+
+  for (p = libel; *p != 0; p++)
   {
-    nouveau->next = pere->list_desc;
-    pere->list_desc = nouveau;
+    if ((p == libel || *(p - 1) == '|') && toupper(*p) == 'I' && toupper(*(p + 1)) == 'D' && *(p + 2) == ':')
+      return atoi(p + 3);
   }
+  return 0;
 }
 
 
-static void raa_decode_desc_arbre(char* reponse, raa_node** tab_noeud)
+static void raa_decode_desc_arbre(char* reponse, raa_sp_tree* tree, int* last_child)
 /* reponse contient
    rank&pere&count&"...name..."&"...libel..."
    synonyme est identifie par pere < 0 et -pere = son principal
  */
 {
-  int num, pere, count, l;
-  char* p, * q, * name, * libel;
+  int num, pere, count;
+  char* p, * q;
 
   num = atoi(reponse);
   p = strchr(reponse, '&');
@@ -3301,80 +4315,456 @@ static void raa_decode_desc_arbre(char* reponse, raa_node** tab_noeud)
   p = strchr(p + 1, '&');
   count = atoi(p + 1);
 /* ne pas brancher un noeud deja branche ailleurs auparavant */
-  if (tab_noeud[num] != NULL)
+  if (num < 2 || num > tree->max_sp || tree->name[num] != 0 || pere < -tree->max_sp || pere > tree->max_sp)
+    return;
+  p = strchr(p + 1, '&') + 1;
+  q = end_quoted(p);
+  tree->name[num] = sp_tree_add_string(tree, p, q - p + 1);
+  if (tree->name[num] == 0)
     return;
-  tab_noeud[num] = (raa_node*)calloc(1, sizeof(raa_node));
-  tab_noeud[num]->rank = num;
   if (pere < 0)   /* un synonyme */
   {
-    ajout_synonyme(tab_noeud[num], tab_noeud[-pere]);
+    ajout_synonyme(tree, num, -pere);
   }
   else
   {
-    tab_noeud[num]->count = count;
-    tab_noeud[num]->parent = tab_noeud[pere];
+    tree->count[num] = count;
     if (num != 2)
-      ajout_branche(tab_noeud[pere], tab_noeud[num]);
+    {
+      tree->parent[num] = pere;
+      ajout_branche(tree, last_child, pere, num);
+    }
   }
 
-  p = strchr(p + 1, '&') + 1;
-  q = p;
-  do
+  if (*q != 0 && *(++q) == '&')
   {
-    q++;
-    if (*q == 0)
-      break;
+    p = q + 1;
+    q = end_quoted(p);
+    tree->libel[num] = sp_tree_add_string(tree, p, q - p + 1);
+    if (tree->libel[num] != 0)
+      tree->tid[num] = label_tid(tree->strings + tree->libel[num]);
   }
-  while (*q != '"' || *(q - 1) == '\\');
-  l = q - p + 1;
-  name = (char*)malloc(l + 1);
-  strncpy(name, p, l); name[l] = 0;
-  unprotect_quotes(name);
-  tab_noeud[num]->name = name;
-  q++;
-  if (*q == '&')
+}
+
+
+static int raa_number_taxa(raa_sp_tree* tree, int* order)
+/* numbers taxa in preorder, so that the subtree of taxon rank holds the taxa numbered
+   from tree->preorder[rank] to tree->preorder_end[rank];
+   order, of size tree->max_sp, receives the ranks of taxa in preorder;
+   returns the number of taxa in the tree
+ */
+{
+  int rank = 2, num = 0;
+
+  while (TRUE)
   {
-    p = q + 1;
-    q = p;
-    do
+    order[num] = rank;
+    tree->preorder[rank] = ++num;
+    if (tree->first_child[rank] != 0)
     {
-      q++;
-      if (*q == 0)
-        break;
+      rank = tree->first_child[rank];
+      continue;
     }
-    while (*q != '"' || *(q - 1) == '\\');
-    l = q - p + 1;
-    libel = (char*)malloc(l + 1);
-    strncpy(libel, p, l); libel[l] = 0;
-    unprotect_quotes(libel);
-    tab_noeud[num]->libel = libel;
-    p = (char*)malloc(l + 1);
-    strcpy(p, libel);
-    majuscules(p);
-    tab_noeud[num]->libel_upcase = p;
-    if (strncmp(p, "ID:", 3) == 0 || (p = strstr(p, "|ID:")) != NULL)
-    {
-      p += 2; if (*p != ':')
-        p++;
-      sscanf(p + 1, "%d", &(tab_noeud[num]->tid) );
+    tree->preorder_end[rank] = num;
+    while (rank != 2 && tree->next_sibling[rank] == 0)
+    {
+      rank = tree->parent[rank];
+      tree->preorder_end[rank] = num;
     }
+    if (rank == 2)
+      return num;
+    rank = tree->next_sibling[rank];
   }
 }
 
 
-static void raa_calc_taxo_count(raa_node* racine)
+int raa_sp_count_taxa(raa_sp_tree* tree)
+/* once all taxa are attached below the root (rank 2), numbers them in preorder and adds to the
+   count of each taxon those of all taxa below it;
+   returns 0 if OK, !=0 if not enough memory
+ */
 {
-  struct raa_pair* paire;
-  int count = 0;
+  int *order, i, total;
+
+  order = (int*)malloc(tree->max_sp * sizeof(int));
+  if (order == NULL)
+    return 1;
+  total = raa_number_taxa(tree, order);
+  /* the subtree of a taxon follows it in preorder: visiting taxa backwards, each taxon is
+     complete when its count is added to its parent's */
+  for (i = total - 1; i > 0; i--)
+    tree->count[tree->parent[order[i]]] += tree->count[order[i]];
+  free(order);
+  return 0;
+}
+
+
+static unsigned sp_name_hash(const char* name, size_t l)
+/* hashes the l first chars of name, ignoring case */
+{
+  unsigned h = 2166136261U;
+
+  while (l-- > 0)
+  {
+    h ^= (unsigned char)toupper((unsigned char)*name++);
+    h *= 16777619U;
+  }
+  return h;
+}
+
+
+static int sp_name_equal(const char* name, size_t l, const char* taxon)
+/* tells whether the l first chars of name are, ignoring case, the name of taxon */
+{
+  while (l-- > 0)
+  {
+    if (*taxon == 0 || toupper((unsigned char)*name++) != toupper((unsigned char)*taxon++))
+      return FALSE;
+  }
+  return *taxon == 0;
+}
+
+
+static int sp_name_ncmp(const char* name, const char* taxon, size_t l)
+/* compares, ignoring case, at most l chars of name and taxon as strncmp does */
+{
+  int c1, c2;
+
+  while (l-- > 0)
+  {
+    c1 = toupper((unsigned char)*name++);
+    c2 = toupper((unsigned char)*taxon++);
+    if (c1 != c2 || c1 == 0)
+      return c1 - c2;
+  }
+  return 0;
+}
+
+
+static void sort_taxa(const raa_sp_tree* tree, int* ranks, int* tmp, int n)
+/* sorts the n taxa of ranks by name, ignoring case; tmp: room for n ints;
+   a merge sort is used rather than qsort, whose comparison function couldn't receive tree without global data
+ */
+{
+  int width, i, left, right, end_left, end_right, k, * swap;
+  int* from = ranks, * to = tmp;
+
+  for (width = 1; width < n; width *= 2)
+  {
+    for (i = 0; i < n; i += 2 * width)
+    {
+      left = i;
+      end_left = (i + width < n ? i + width : n);
+      right = end_left;
+      end_right = (i + 2 * width < n ? i + 2 * width : n);
+      k = i;
+      while (left < end_left && right < end_right)
+      {
+        if (sp_name_ncmp(RAA_SP_NAME(tree, from[right]), RAA_SP_NAME(tree, from[left]), (size_t)-1) < 0)
+          to[k++] = from[right++];
+        else
+          to[k++] = from[left++];
+      }
+      while (left < end_left)
+        to[k++] = from[left++];
+      while (right < end_right)
+        to[k++] = from[right++];
+    }
+    swap = from; from = to; to = swap;
+  }
+  if (from != ranks)
+    memcpy(ranks, from, n * sizeof(int));
+}
+
+
+static int raa_index_taxa(raa_sp_tree* tree)
+/* builds the hash table and the sorted array of taxon names, without the root; returns 0 iff OK */
+{
+  unsigned size, h;
+  int rank, total = 0, * tmp;
+  const char* name;
+
+  for (rank = 3; rank <= tree->max_sp; rank++)
+  {
+    if (tree->name[rank] != 0)
+      total++;
+  }
+  size = 16;
+  while (size < 2 * (unsigned)total)
+    size *= 2;
+  tree->name_index = (int*)calloc(size, sizeof(int));
+  tree->sorted = (int*)malloc((total + 1) * sizeof(int));
+  if (tree->name_index == NULL || tree->sorted == NULL)
+    return 1;
+  tree->name_index_mask = size - 1;
+  for (rank = 3; rank <= tree->max_sp; rank++)
+  {
+    if (tree->name[rank] == 0)
+      continue;
+    name = RAA_SP_NAME(tree, rank);
+    h = sp_name_hash(name, strlen(name)) & tree->name_index_mask;
+    /* with duplicate names, the lowest rank is kept */
+    while (tree->name_index[h] != 0 &&
+        !sp_name_equal(name, strlen(name), RAA_SP_NAME(tree, tree->name_index[h])))
+      h = (h + 1) & tree->name_index_mask;
+    if (tree->name_index[h] == 0)
+      tree->name_index[h] = rank;
+    tree->sorted[tree->total_sorted++] = rank;
+  }
+  tmp = (int*)malloc((total + 1) * sizeof(int));
+  if (tmp == NULL)
+    return 1;
+  sort_taxa(tree, tree->sorted, tmp, tree->total_sorted);
+  free(tmp);
+  return 0;
+}
+
+
+static void raa_free_sp_tree(raa_sp_tree* tree)
+{
+  if (tree->mapping != NULL)
+  {
+#if defined(unix) || defined(__APPLE__)
+    munmap(tree->mapping, tree->mapping_size);
+#else
+    free(tree->mapping);
+#endif
+    free(tree);
+    return;
+  }
+  free(tree->parent);
+  free(tree->first_child);
+  free(tree->next_sibling);
+  free(tree->syno);
+  free(tree->tid);
+  free(tree->count);
+  free(tree->preorder);
+  free(tree->preorder_end);
+  free(tree->name);
+  free(tree->libel);
+  free(tree->strings);
+  if (tree->name_index != NULL)
+    free(tree->name_index);
+  if (tree->sorted != NULL)
+    free(tree->sorted);
+  free(tree);
+}
+
+
+static raa_sp_tree* raa_alloc_sp_tree(int max_sp)
+/* allocates an empty tree for taxa of rank up to max_sp */
+{
+  raa_sp_tree* tree;
+
+  tree = (raa_sp_tree*)calloc(1, sizeof(raa_sp_tree));
+  if (tree == NULL)
+    return NULL;
+  tree->max_sp = max_sp;
+  tree->parent = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->first_child = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->next_sibling = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->syno = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->tid = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->count = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->preorder = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->preorder_end = (int*)calloc(max_sp + 1, sizeof(int));
+  tree->name = (unsigned*)calloc(max_sp + 1, sizeof(unsigned));
+  tree->libel = (unsigned*)calloc(max_sp + 1, sizeof(unsigned));
+  tree->strings_size = 40 * (size_t)max_sp + 1000;
+  tree->strings = (char*)malloc(tree->strings_size);
+  if (tree->parent == NULL || tree->first_child == NULL || tree->next_sibling == NULL || tree->syno == NULL ||
+      tree->tid == NULL || tree->count == NULL || tree->preorder == NULL || tree->preorder_end == NULL ||
+      tree->name == NULL || tree->libel == NULL || tree->strings == NULL)
+  {
+    raa_free_sp_tree(tree);
+    return NULL;
+  }
+  tree->strings[0] = 0;
+  tree->lstrings = 1;
+  return tree;
+}
+
+
+/* the taxonomy is decoded by a second thread while the first one reads and inflates it:
+   lines are passed to the decoder in batches of a ring of TAXO_BATCHES buffers */
+#define TAXO_BATCHES 4
+#define TAXO_BATCH_SIZE 262144
+struct taxo_batch
+{
+  char* lines; /* count lines, each followed by a NUL */
+  size_t used, size;
+  int count;
+  int full; /* TRUE when filled by the reader and not yet decoded */
+};
+struct taxo_pipe
+{
+  raa_sp_tree* tree;
+  int* last_child;
+  struct taxo_batch batch[TAXO_BATCHES];
+  int put; /* batch being filled by the reader */
+  int threaded; /* FALSE when lines are decoded by the reader itself */
+  int ended; /* TRUE when the reader has no more lines */
+  int failed; /* TRUE when a line could not be given to the decoder: the tree is incomplete */
+#ifdef RAA_TAXO_THREADS
+  pthread_t decoder;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+#endif
+};
+
+
+#ifdef RAA_TAXO_THREADS
+static void* taxo_decoder(void* arg)
+/* decodes batches of lines as the reader fills them, until it has no more lines */
+{
+  struct taxo_pipe* pipe = (struct taxo_pipe*)arg;
+  struct taxo_batch* b;
+  char* line;
+  int get = 0, i, full;
+
+  while (TRUE)
+  {
+    b = &pipe->batch[get];
+    pthread_mutex_lock(&pipe->lock);
+    while (!b->full && !pipe->ended)
+      pthread_cond_wait(&pipe->changed, &pipe->lock);
+    full = b->full;
+    pthread_mutex_unlock(&pipe->lock);
+    if (!full)
+      break;
+    line = b->lines;
+    for (i = 0; i < b->count; i++)
+    {
+      raa_decode_desc_arbre(line, pipe->tree, pipe->last_child);
+      line += strlen(line) + 1;
+    }
+    pthread_mutex_lock(&pipe->lock);
+    b->used = 0;
+    b->count = 0;
+    b->full = FALSE;
+    pthread_cond_broadcast(&pipe->changed);
+    pthread_mutex_unlock(&pipe->lock);
+    get = (get + 1) % TAXO_BATCHES;
+  }
+  return NULL;
+}
+#endif
+
 
-  paire = racine->list_desc;
-  while (paire != NULL)
+static void taxo_pipe_start(struct taxo_pipe* pipe, raa_sp_tree* tree, int* last_child)
+{
+#ifdef RAA_TAXO_THREADS
+  int i;
+
+#endif
+  memset(pipe, 0, sizeof(struct taxo_pipe));
+  pipe->tree = tree;
+  pipe->last_child = last_child;
+#ifdef RAA_TAXO_THREADS
+  pipe->threaded = TRUE;
+  for (i = 0; i < TAXO_BATCHES; i++)
+  {
+    pipe->batch[i].size = TAXO_BATCH_SIZE;
+    pipe->batch[i].lines = (char*)malloc(TAXO_BATCH_SIZE);
+    if (pipe->batch[i].lines == NULL)
+      pipe->threaded = FALSE;
+  }
+  if (pipe->threaded)
+  {
+    pthread_mutex_init(&pipe->lock, NULL);
+    pthread_cond_init(&pipe->changed, NULL);
+    if (pthread_create(&pipe->decoder, NULL, taxo_decoder, pipe) != 0)
+    {
+      pthread_mutex_destroy(&pipe->lock);
+      pthread_cond_destroy(&pipe->changed);
+      pipe->threaded = FALSE;
+    }
+  }
+#endif
+}
+
+
+#ifdef RAA_TAXO_THREADS
+static void taxo_publish(struct taxo_pipe* pipe)
+/* hands the batch being filled to the decoder, and waits until the next batch is free */
+{
+  pthread_mutex_lock(&pipe->lock);
+  pipe->batch[pipe->put].full = TRUE;
+  pthread_cond_broadcast(&pipe->changed);
+  pipe->put = (pipe->put + 1) % TAXO_BATCHES;
+  while (pipe->batch[pipe->put].full)
+    pthread_cond_wait(&pipe->changed, &pipe->lock);
+  pthread_mutex_unlock(&pipe->lock);
+}
+#endif
+
+
+static void taxo_pipe_put(struct taxo_pipe* pipe, char* line, size_t l)
+/* gives a line of the taxonomy to the decoder */
+{
+#ifdef RAA_TAXO_THREADS
+  struct taxo_batch* b;
+  char* p;
+
+  if (pipe->failed)
+    return;
+  if (pipe->threaded)
   {
-    raa_calc_taxo_count(paire->value);
-    count += paire->value->count;
-    paire = paire->next;
+    b = &pipe->batch[pipe->put];
+    if (b->used + l + 1 > b->size)
+    {
+      if (b->count > 0)
+      {
+        taxo_publish(pipe);
+        b = &pipe->batch[pipe->put];
+      }
+      if (l + 1 > b->size)
+      {
+        p = (char*)realloc(b->lines, l + 1);
+        if (p == NULL)
+        {
+          pipe->failed = TRUE;
+          return;
+        }
+        b->lines = p;
+        b->size = l + 1;
+      }
+    }
+    memcpy(b->lines + b->used, line, l);
+    b->lines[b->used + l] = 0;
+    b->used += l + 1;
+    b->count++;
+    return;
+  }
+#endif
+  raa_decode_desc_arbre(line, pipe->tree, pipe->last_child);
+}
+
+
+static void taxo_pipe_end(struct taxo_pipe* pipe)
+/* waits until all lines given to the decoder are decoded */
+{
+  int i;
+
+#ifdef RAA_TAXO_THREADS
+  if (pipe->threaded)
+  {
+    pthread_mutex_lock(&pipe->lock);
+    if (pipe->batch[pipe->put].count > 0)
+      pipe->batch[pipe->put].full = TRUE;
+    pipe->ended = TRUE;
+    pthread_cond_broadcast(&pipe->changed);
+    pthread_mutex_unlock(&pipe->lock);
+    pthread_join(pipe->decoder, NULL);
+    pthread_mutex_destroy(&pipe->lock);
+    pthread_cond_destroy(&pipe->changed);
+  }
+#endif
+  for (i = 0; i < TAXO_BATCHES; i++)
+  {
+    if (pipe->batch[i].lines != NULL)
+      free(pipe->batch[i].lines);
   }
-  racine->count += count;
 }
 
 
@@ -3384,11 +4774,12 @@ int raa_loadtaxonomy(raa_db_access* raa_current_db, char* rootname,
 /* charge la taxo complete dans raa_current_db->sp_tree et rend 0 ssi OK */
 {
   int totspec, i, maxtid;
-  raa_node** tab_noeud;
-  struct raa_pair* pair, * pair2;
+  raa_sp_tree* tree;
+  int* last_child;
+  struct taxo_pipe pipe;
   char* reponse;
+  size_t l;
   int count, pourcent, prev_pourcent = 0;
-  void* opaque;
   int interrupted;
 
   if (raa_current_db == NULL)
@@ -3405,51 +4796,47 @@ int raa_loadtaxonomy(raa_db_access* raa_current_db, char* rootname,
    loadtaxonomy END.
    <end of compressed data, back to normal data >
  */
-  opaque = prepare_sock_gz_r( raa_current_db->raa_sockfdr );
-  reponse = z_read_sock(opaque);
+  if (raa_zlib_open(raa_current_db) != 0)
+    return 1;
+  reponse = read_sock(raa_current_db);
   if (reponse == NULL || strncmp(reponse, "code=0&total=", 13) != 0)
   {
+    raa_zlib_close(raa_current_db);
     return 1;
   }
   totspec = atoi(reponse + 13);
-  tab_noeud = (raa_node**)calloc(totspec + 1, sizeof(raa_node*));
+  tree = raa_alloc_sp_tree(totspec);
+  last_child = (int*)calloc(totspec + 1, sizeof(int));
+  if (tree != NULL && last_child == NULL)
+  {
+    raa_free_sp_tree(tree);
+    tree = NULL;
+  }
+  if (tree != NULL)
+    taxo_pipe_start(&pipe, tree, last_child);
   count = 0;
   while (TRUE)
   {
-    reponse = z_read_sock(opaque);
-    if (strcmp(reponse, "loadtaxonomy END.") == 0)
+    reponse = read_sock_len(raa_current_db, &l);
+    if (reponse == NULL || strcmp(reponse, "loadtaxonomy END.") == 0)
     {
-      if (interrupted && (tab_noeud != NULL) )
+      if (tree != NULL)
+        taxo_pipe_end(&pipe);
+      raa_zlib_close(raa_current_db);
+      if (reponse == NULL)
+        interrupted = TRUE;
+      if (interrupted && (tree != NULL) )
       {
-        for (i = 2; i <= totspec; i++)
-        {
-          if (tab_noeud[i] == NULL)
-            continue;
-          if (tab_noeud[i]->name != NULL)
-            free(tab_noeud[i]->name);
-          if (tab_noeud[i]->libel != NULL)
-            free(tab_noeud[i]->libel);
-          if (tab_noeud[i]->libel_upcase != NULL)
-            free(tab_noeud[i]->libel_upcase);
-          pair = tab_noeud[i]->list_desc;
-          while (pair != NULL)
-          {
-            pair2 = pair->next;
-            free(pair);
-            pair = pair2;
-          }
-          free(tab_noeud[i]);
-        }
-        free(tab_noeud);
-        tab_noeud = NULL;
+        raa_free_sp_tree(tree);
+        tree = NULL;
         /* just to consume ESC that may have arrived after loadtaxonomy END. */
         sock_fputs(raa_current_db, "null_command\n");
         read_sock(raa_current_db);
       }
       break;
     }
-    if (tab_noeud != NULL)
-      raa_decode_desc_arbre(reponse, tab_noeud);
+    if (tree != NULL)
+      taxo_pipe_put(&pipe, reponse, l);
     pourcent = ((++count) * 100) / totspec;
     if (pourcent > prev_pourcent)
     {
@@ -3465,18 +4852,29 @@ int raa_loadtaxonomy(raa_db_access* raa_current_db, char* rootname,
       }
     }
   }
-  close_sock_gz_r(opaque);
-  if (tab_noeud != NULL)
+  if (last_child != NULL)
+    free(last_child);
+  if (tree != NULL && (tree->name[2] == 0 || pipe.failed || raa_sp_count_taxa(tree) != 0))
+  {
+    raa_free_sp_tree(tree);
+    tree = NULL;
+  }
+  if (tree != NULL)
+  {
+    tree->name[2] = sp_tree_add_string(tree, rootname, strlen(rootname));
+    if (raa_index_taxa(tree) != 0)
+    {
+      raa_free_sp_tree(tree);
+      tree = NULL;
+    }
+  }
+  if (tree != NULL)
   {
-    redresse_branches(tab_noeud[2]);
-    raa_calc_taxo_count(tab_noeud[2]);
-    free(tab_noeud[2]->name);
-    tab_noeud[2]->name = strdup(rootname);
     maxtid = 0;
     for (i = 2; i <= totspec; i++)
     {
-      if (tab_noeud[i] != NULL && tab_noeud[i]->tid > maxtid)
-        maxtid = tab_noeud[i]->tid;
+      if (tree->tid[i] > maxtid)
+        maxtid = tree->tid[i];
     }
     raa_current_db->tid_to_rank = (int*)calloc(maxtid + 1, sizeof(int));
     if (raa_current_db->tid_to_rank != NULL)
@@ -3484,169 +4882,601 @@ int raa_loadtaxonomy(raa_db_access* raa_current_db, char* rootname,
       raa_current_db->max_tid = maxtid;
       for (i = 2; i <= totspec; i++)
       {
-        if (tab_noeud[i] != NULL && tab_noeud[i]->tid != 0)
-          raa_current_db->tid_to_rank[tab_noeud[i]->tid] =
-              tab_noeud[i]->rank;
+        if (tree->name[i] != 0 && tree->tid[i] > 0)
+          raa_current_db->tid_to_rank[tree->tid[i]] = i;
       }
     }
-    raa_current_db->sp_tree = tab_noeud;
+    raa_current_db->sp_tree = tree;
   }
-  return tab_noeud == NULL ? 1 : 0;
+  return tree == NULL ? 1 : 0;
+}
+
+
+void raa_free_taxonomy(raa_db_access* raa_current_db)
+/* frees the taxonomy tree loaded by raa_loadtaxonomy */
+{
+  if (raa_current_db == NULL)
+    return;
+  /* a mapped taxonomy image also holds tid_to_rank */
+  if (raa_current_db->tid_to_rank != NULL &&
+      (raa_current_db->sp_tree == NULL || raa_current_db->sp_tree->mapping == NULL))
+    free(raa_current_db->tid_to_rank);
+  if (raa_current_db->sp_tree != NULL)
+    raa_free_sp_tree(raa_current_db->sp_tree);
+  raa_current_db->sp_tree = NULL;
+  raa_current_db->tid_to_rank = NULL;
+  raa_current_db->max_tid = 0;
+}
+
+
+/* taxonomy image: a header followed by the arrays of the tree at 8-byte aligned positions */
+#define SP_IMAGE_MAGIC "RAATAXO"
+#define SP_IMAGE_VERSION 2
+#define SP_IMAGE_BOM 0x01020304
+#define SP_IMAGE_ARRAYS 14
+#define SP_IMAGE_ALIGN(n) (((n) + 7) & ~(raa_long)7)
+struct sp_image_header
+{
+  char magic[8];
+  unsigned version;
+  unsigned byte_order; /* SP_IMAGE_BOM as written by the host that saved the image */
+  unsigned header_size;
+  char stamp[200]; /* database, release and size of the saved taxonomy */
+  int max_sp, max_tid, total_sorted;
+  unsigned name_index_mask;
+  raa_long lstrings;
+  raa_long offset[SP_IMAGE_ARRAYS]; /* positions in image of the arrays of the tree */
+};
+
+
+static void sp_image_layout(raa_sp_tree* tree, int** ptid_to_rank, int max_tid, void** slots[], raa_long sizes[])
+/* gives the addresses of the pointers to all arrays of a taxonomy image and their sizes in bytes */
+{
+  raa_long n = (raa_long)tree->max_sp + 1;
+  int i = 0;
+
+  slots[i] = (void**)&tree->parent; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->first_child; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->next_sibling; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->syno; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->tid; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->count; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->preorder; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->preorder_end; sizes[i++] = n * sizeof(int);
+  slots[i] = (void**)&tree->name; sizes[i++] = n * sizeof(unsigned);
+  slots[i] = (void**)&tree->libel; sizes[i++] = n * sizeof(unsigned);
+  slots[i] = (void**)&tree->name_index; sizes[i++] = ((raa_long)tree->name_index_mask + 1) * sizeof(int);
+  slots[i] = (void**)&tree->sorted; sizes[i++] = (raa_long)tree->total_sorted * sizeof(int);
+  slots[i] = (void**)ptid_to_rank; sizes[i++] = ((raa_long)max_tid + 1) * sizeof(int);
+  slots[i] = (void**)&tree->strings; sizes[i++] = (raa_long)tree->lstrings;
+}
+
+
+static void taxonomy_stamp(raa_db_access* raa_current_db, char* stamp)
+/* identifies the database release whose taxonomy is loaded, by its name, the release and update date
+   given by the server in its list of known databases, and the numbers of sequences and species
+ */
+{
+  char** names, ** descriptions;
+  const char* release = "";
+  int i, n;
+
+  n = raa_knowndbs(raa_current_db, &names, &descriptions);
+  for (i = 0; i < n; i++)
+  {
+    if (descriptions[i] != NULL && sp_name_ncmp(names[i], raa_current_db->dbname, (size_t)-1) == 0)
+      release = descriptions[i];
+  }
+  sprintf(stamp, "%.40s (%.100s) seqs=%d species=%d", raa_current_db->dbname, release, raa_current_db->nseq,
+      raa_read_first_rec(raa_current_db, raa_spec));
+  for (i = 0; i < n; i++)
+  {
+    free(names[i]);
+    if (descriptions[i] != NULL)
+      free(descriptions[i]);
+  }
+  if (n > 0)
+  {
+    free(names);
+    free(descriptions);
+  }
+}
+
+
+int raa_save_taxonomy(raa_db_access* raa_current_db, const char* path)
+/* writes the loaded taxonomy to file path as an image that raa_map_taxonomy can map in memory;
+   the file is replaced only once fully written; returns 0 iff OK
+ */
+{
+  struct sp_image_header h;
+  void** slots[SP_IMAGE_ARRAYS];
+  raa_long sizes[SP_IMAGE_ARRAYS], pos;
+  static const char zeros[8] = { 0 };
+  char* tmpname;
+  FILE* out;
+  int i, err;
+
+  if (raa_current_db == NULL || raa_current_db->sp_tree == NULL || raa_current_db->tid_to_rank == NULL)
+    return 1;
+  memset(&h, 0, sizeof(h));
+  strcpy(h.magic, SP_IMAGE_MAGIC);
+  h.version = SP_IMAGE_VERSION;
+  h.byte_order = SP_IMAGE_BOM;
+  h.header_size = sizeof(h);
+  taxonomy_stamp(raa_current_db, h.stamp);
+  h.max_sp = raa_current_db->sp_tree->max_sp;
+  h.max_tid = raa_current_db->max_tid;
+  h.total_sorted = raa_current_db->sp_tree->total_sorted;
+  h.name_index_mask = raa_current_db->sp_tree->name_index_mask;
+  h.lstrings = (raa_long)raa_current_db->sp_tree->lstrings;
+  sp_image_layout(raa_current_db->sp_tree, &raa_current_db->tid_to_rank, raa_current_db->max_tid, slots, sizes);
+  pos = SP_IMAGE_ALIGN((raa_long)sizeof(h));
+  for (i = 0; i < SP_IMAGE_ARRAYS; i++)
+  {
+    h.offset[i] = pos;
+    pos += SP_IMAGE_ALIGN(sizes[i]);
+  }
+
+  tmpname = (char*)malloc(strlen(path) + 5);
+  if (tmpname == NULL)
+    return 1;
+  sprintf(tmpname, "%s.tmp", path);
+  out = fopen(tmpname, "wb");
+  if (out == NULL)
+  {
+    free(tmpname);
+    return 1;
+  }
+  err = fwrite(&h, sizeof(h), 1, out) != 1;
+  pos = sizeof(h);
+  for (i = 0; i < SP_IMAGE_ARRAYS && !err; i++)
+  {
+    err = fwrite(zeros, 1, (size_t)(h.offset[i] - pos), out) != (size_t)(h.offset[i] - pos) ||
+        fwrite(*slots[i], 1, (size_t)sizes[i], out) != (size_t)sizes[i];
+    pos = h.offset[i] + sizes[i];
+  }
+  err = (fclose(out) != 0) || err;
+  if (!err)
+    err = rename(tmpname, path) != 0;
+  if (err)
+    remove(tmpname);
+  free(tmpname);
+  return err;
+}
+
+
+static int sp_image_check(const raa_sp_tree* tree, const int* tid_to_rank, int max_tid)
+/* checks that a mapped taxonomy image can be used without reading outside it or looping forever:
+   ranks, string positions and preorder numbers are in range, the string pool is terminated,
+   the preorder numbers of each taxon lie within those of its parent and follow those of its
+   previous sibling, synonyms form rings, and the name hash table has a free slot; returns 0 iff OK
+ */
+{
+  int n = tree->max_sp, r, p, c, err = 0;
+  unsigned mask = tree->name_index_mask;
+  int* pred;
+
+  if (tree->strings[tree->lstrings - 1] != 0 || mask < 15 || (mask & (mask + 1)) != 0 || tree->total_sorted > n)
+    return 1;
+  for (r = 0; r <= n; r++)
+  {
+    if (tree->name[r] >= tree->lstrings || tree->libel[r] >= tree->lstrings ||
+        (unsigned)tree->parent[r] > (unsigned)n || (unsigned)tree->first_child[r] > (unsigned)n ||
+        (unsigned)tree->next_sibling[r] > (unsigned)n || (unsigned)tree->syno[r] > (unsigned)n ||
+        (unsigned)tree->preorder[r] > (unsigned)n || (unsigned)tree->preorder_end[r] > (unsigned)n)
+      return 1;
+  }
+  for (r = 0; r <= n; r++)
+  {
+    p = tree->parent[r];
+    if (p != 0 && (tree->preorder[p] == 0 || tree->preorder[r] <= tree->preorder[p] ||
+        tree->preorder_end[r] < tree->preorder[r] || tree->preorder_end[r] > tree->preorder_end[p]))
+      return 1;
+    c = tree->first_child[r];
+    if (c != 0 && (tree->parent[c] != r || tree->preorder[c] != tree->preorder[r] + 1))
+      return 1;
+    c = tree->next_sibling[r];
+    if (c != 0 && (p == 0 || tree->parent[c] != p || tree->preorder[c] != tree->preorder_end[r] + 1))
+      return 1;
+  }
+  c = 0; /* free slots of name_index, that end the probing of raa_sp_find */
+  for (r = 0; r <= (int)mask; r++)
+  {
+    if ((unsigned)tree->name_index[r] > (unsigned)n)
+      return 1;
+    if (tree->name_index[r] == 0)
+      c++;
+  }
+  if (c == 0)
+    return 1;
+  for (r = 0; r < tree->total_sorted; r++)
+  {
+    if (tree->sorted[r] < 2 || tree->sorted[r] > n)
+      return 1;
+  }
+  for (r = 0; r <= max_tid; r++)
+  {
+    if ((unsigned)tid_to_rank[r] > (unsigned)n)
+      return 1;
+  }
+  /* each taxon of a synonym ring is the synonym of exactly one other */
+  pred = (int*)calloc(n + 1, sizeof(int));
+  if (pred == NULL)
+    return 1;
+  for (r = 0; r <= n && !err; r++)
+  {
+    c = tree->syno[r];
+    if (c != 0)
+    {
+      err = pred[c] != 0 || c == r;
+      pred[c] = r;
+    }
+  }
+  for (r = 0; r <= n && !err; r++)
+    err = (tree->syno[r] != 0) != (pred[r] != 0);
+  free(pred);
+  return err;
+}
+
+
+int raa_map_taxonomy(raa_db_access* raa_current_db, const char* path)
+/* maps in memory, read-only, the taxonomy image written by raa_save_taxonomy in file path,
+   that then behaves as if loaded by raa_loadtaxonomy; the image may be shared by several processes
+   return values: 0 if OK, 1 if the file can't be read or is not a consistent taxonomy image of this program,
+   2 if the image was made for another database or release
+ */
+{
+  struct sp_image_header* h;
+  raa_sp_tree* tree;
+  void** slots[SP_IMAGE_ARRAYS];
+  raa_long sizes[SP_IMAGE_ARRAYS];
+  char stamp[sizeof(h->stamp)];
+  char* image;
+  size_t size;
+  int i, err, max_tid;
+  int* tid_to_rank;
+
+  if (raa_current_db == NULL)
+    return 1;
+  if (raa_current_db->sp_tree != NULL)
+    return 0;
+#if defined(unix) || defined(__APPLE__)
+  {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+      return 1;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct sp_image_header))
+    {
+      close(fd);
+      return 1;
+    }
+    size = (size_t)st.st_size;
+    image = (char*)mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == (char*)MAP_FAILED)
+      return 1;
+  }
+#else
+  {
+    FILE* in = fopen(path, "rb");
+    if (in == NULL)
+      return 1;
+    fseek(in, 0, SEEK_END);
+    size = (size_t)ftell(in);
+    rewind(in);
+    image = (size < sizeof(struct sp_image_header) ? NULL : (char*)malloc(size));
+    if (image != NULL && fread(image, 1, size, in) != size)
+    {
+      free(image);
+      image = NULL;
+    }
+    fclose(in);
+    if (image == NULL)
+      return 1;
+  }
+#endif
+  tree = (raa_sp_tree*)calloc(1, sizeof(raa_sp_tree));
+  if (tree == NULL)
+    err = 1;
+  else
+  {
+    tree->mapping = image;
+    tree->mapping_size = size;
+    h = (struct sp_image_header*)image;
+    err = strncmp(h->magic, SP_IMAGE_MAGIC, sizeof(h->magic)) != 0 || h->version != SP_IMAGE_VERSION ||
+        h->byte_order != SP_IMAGE_BOM || h->header_size != sizeof(*h) || h->max_sp < 2 || h->max_tid < 0 ||
+        h->total_sorted < 0 || h->lstrings < 1;
+    if (!err)
+    {
+      taxonomy_stamp(raa_current_db, stamp);
+      if (strncmp(stamp, h->stamp, sizeof(stamp)) != 0)
+        err = 2;
+    }
+  }
+  if (!err)
+  {
+    tree->max_sp = h->max_sp;
+    tree->total_sorted = h->total_sorted;
+    tree->name_index_mask = h->name_index_mask;
+    tree->lstrings = tree->strings_size = (size_t)h->lstrings;
+    max_tid = h->max_tid;
+    sp_image_layout(tree, &tid_to_rank, max_tid, slots, sizes);
+    for (i = 0; i < SP_IMAGE_ARRAYS && !err; i++)
+    {
+      if (h->offset[i] < (raa_long)sizeof(*h) || h->offset[i] % 8 != 0 || h->offset[i] + sizes[i] > (raa_long)size)
+        err = 1;
+      else
+        *slots[i] = image + h->offset[i];
+    }
+    if (!err)
+      err = sp_image_check(tree, tid_to_rank, max_tid);
+  }
+  if (err)
+  {
+    if (tree != NULL)
+      raa_free_sp_tree(tree);
+    else
+    {
+#if defined(unix) || defined(__APPLE__)
+      munmap(image, size);
+#else
+      free(image);
+#endif
+    }
+    return err;
+  }
+  raa_current_db->sp_tree = tree;
+  raa_current_db->tid_to_rank = tid_to_rank;
+  raa_current_db->max_tid = max_tid;
+  return 0;
+}
+
+
+int raa_sp_major(const raa_sp_tree* tree, int rank)
+/* returns the rank of the major taxon among the synonyms of taxon rank (can be rank itself) */
+{
+  int start = rank;
+
+  while (rank != 2 && tree->parent[rank] == 0)
+  {
+    rank = tree->syno[rank];
+    if (rank == 0 || rank == start)
+      return start;
+  }
+  return rank;
+}
+
+
+int raa_sp_find(const raa_sp_tree* tree, const char* name)
+/* returns the rank of the taxon named name, case and trailing spaces being ignored, 0 if none;
+   the root is not found by its name
+ */
+{
+  size_t l;
+  unsigned h;
+
+  l = strlen(name);
+  while (l > 0 && name[l - 1] == ' ')
+    l--;
+  h = sp_name_hash(name, l) & tree->name_index_mask;
+  while (tree->name_index[h] != 0)
+  {
+    if (sp_name_equal(name, l, RAA_SP_NAME(tree, tree->name_index[h])))
+      return tree->name_index[h];
+    h = (h + 1) & tree->name_index_mask;
+  }
+  return 0;
+}
+
+
+int raa_sp_match(const raa_sp_tree* tree, const char* pattern, int maxcount, int** pranks)
+/* puts in *pranks a malloc'ed array of the ranks of taxa, the root excepted, whose name matches pattern,
+   in alphabetical order of names; case is not significant and @ is the wildcard (e.g., HOMO@ finds
+   all names that begin with HOMO); at most maxcount ranks are given if maxcount > 0
+   return value: number of ranks in *pranks, -1 if error
+ */
+{
+  char* motif, ** posmot, * p;
+  char name[WIDTH_MAX + 1];
+  int nbrmots, count, size, first, last, middle, i, l;
+  size_t lprefix;
+  int* ranks;
+
+  motif = strdup(pattern);
+  if (motif == NULL)
+    return -1;
+  trim_key(motif);
+  majuscules(motif);
+  p = strchr(motif, '@');
+  lprefix = (p == NULL ? strlen(motif) : (size_t)(p - motif));
+  /* the taxa whose name begins with the part of pattern before the first @ are contiguous in tree->sorted */
+  first = 0; last = tree->total_sorted;
+  while (first < last)
+  {
+    middle = (first + last) / 2;
+    if (sp_name_ncmp(RAA_SP_NAME(tree, tree->sorted[middle]), motif, lprefix) < 0)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+  posmot = (char**)malloc((strlen(motif) + 1) * sizeof(char*));
+  size = (maxcount > 0 && maxcount < 100 ? maxcount : 100);
+  ranks = (int*)malloc(size * sizeof(int));
+  if (posmot == NULL || ranks == NULL)
+  {
+    free(motif);
+    if (posmot != NULL)
+      free(posmot);
+    if (ranks != NULL)
+      free(ranks);
+    return -1;
+  }
+  nbrmots = prepch(motif, posmot);
+  count = 0;
+  for (i = first; i < tree->total_sorted && (maxcount <= 0 || count < maxcount); i++)
+  {
+    p = RAA_SP_NAME(tree, tree->sorted[i]);
+    if (sp_name_ncmp(p, motif, lprefix) != 0)
+      break;
+    if (nbrmots == 0)
+    {
+      /* no wildcard: the name must be the pattern */
+      if (p[lprefix] != 0)
+        break;
+    }
+    else
+    {
+      l = (int)strlen(p);
+      if (l > WIDTH_MAX)
+        l = WIDTH_MAX;
+      memcpy(name, p, l);
+      name[l] = 0;
+      majuscules(name);
+      if (!compch(name, l, posmot, nbrmots))
+        continue;
+    }
+    if (count >= size)
+    {
+      size *= 2;
+      p = (char*)realloc(ranks, size * sizeof(int));
+      if (p == NULL)
+      {
+        count = -1;
+        break;
+      }
+      ranks = (int*)p;
+    }
+    ranks[count++] = tree->sorted[i];
+  }
+  free(motif);
+  free(posmot);
+  if (count == -1)
+  {
+    free(ranks);
+    return -1;
+  }
+  *pranks = ranks;
+  return count;
 }
 
 
 char* raa_get_taxon_info(raa_db_access* raa_current_db, char* name, int rank, int tid, int* p_rank,
-    int* p_tid, int* p_parent, struct raa_pair** p_desc_list)
+    int* p_tid, int* p_parent, int* p_first_child)
 /*
    from a taxon identified by its name or, if name is NULL, by its rank or, if rank is 0, by its taxon ID (tid)
    computes :
    - if p_rank != NULL, the taxon rank in *p_rank
    - if p_tid != NULL, the taxon ID in *p_tid
    - if p_parent != NULL, the taxon's parent rank in *p_parent (2 indicates that taxon is at top level)
-   - if p_desc_list != NULL, the start of the linked chain of taxon's descending taxa in *p_desc_list
+   - if p_first_child != NULL, the rank of taxon's first descending taxon in *p_first_child (0 if none),
+     others are obtained following raa_current_db->sp_tree->next_sibling
    returns the taxon name, or NULL if any error
  */
 {
-  int totspec;
+  raa_sp_tree* tree;
 
   if (raa_current_db == NULL)
     return NULL;
   if (raa_current_db->sp_tree == NULL)
     raa_loadtaxonomy(raa_current_db, "root", NULL, NULL, NULL, NULL);
-  if (raa_current_db->sp_tree == NULL)
+  tree = raa_current_db->sp_tree;
+  if (tree == NULL)
     return NULL;
-  totspec = raa_read_first_rec(raa_current_db, raa_spec);
   if (name != NULL)
-  {
-    name = strdup(name);
-    if (name == NULL)
-      return NULL;
-    trim_key(name); majuscules(name);
-    for (rank = 3; rank <= totspec; rank++)
-    {
-      if (raa_current_db->sp_tree[rank] != NULL && strcmp(name, raa_current_db->sp_tree[rank]->name) == 0)
-        break;
-    }
-    free(name);
-  }
-  if (name == NULL && rank == 0 && tid >= 1 && tid <= raa_current_db->max_tid)
+    rank = raa_sp_find(tree, name);
+  else if (rank == 0 && tid >= 1 && tid <= raa_current_db->max_tid)
     rank = raa_current_db->tid_to_rank[tid];
-  if (rank > totspec || rank < 2 || raa_current_db->sp_tree[rank] == NULL)
+  if (!RAA_SP_PRESENT(tree, rank))
     return NULL;
-  if (rank != 2)
-  {
-    while (raa_current_db->sp_tree[rank]->parent == NULL)
-    {
-      rank = raa_current_db->sp_tree[rank]->syno->rank;
-    }
-  }
+  rank = raa_sp_major(tree, rank);
   if (p_rank != NULL)
     *p_rank = rank;
   if (p_tid != NULL)
-    *p_tid = raa_current_db->sp_tree[rank]->tid;
+    *p_tid = tree->tid[rank];
   if (p_parent != NULL)
-    *p_parent = ( raa_current_db->sp_tree[rank]->parent != NULL ?
-        raa_current_db->sp_tree[rank]->parent->rank : 0);
-  if (p_desc_list != NULL)
-    *p_desc_list = raa_current_db->sp_tree[rank]->list_desc;
-  return raa_current_db->sp_tree[rank]->name;
+    *p_parent = tree->parent[rank];
+  if (p_first_child != NULL)
+    *p_first_child = tree->first_child[rank];
+  return RAA_SP_NAME(tree, rank);
 }
 
 
-static char* raa_getattributes_both(raa_db_access* raa_current_db, const char* id, int rank,
+void raa_getattributes_send(raa_db_access* raa_current_db, const char* id, int rank, int wantseq)
+/* sends a getattributes command for a sequence identified by name or acc. no. (id != NULL) or by rank,
+   without waiting for its reply, that must be later read by raa_getattributes_receive.
+   wantseq: TRUE iff the full sequence is also requested
+ */
+{
+  if (raa_current_db == NULL)
+    return;
+  if (id != NULL)
+    sock_printf(raa_current_db, "getattributes&id=%s&seq=%c\n", id, wantseq ? 'T' : 'F');
+  else
+    sock_printf(raa_current_db, "getattributes&rank=%d&seq=%c\n", rank, wantseq ? 'T' : 'F');
+}
+
+
+char* raa_getattributes_receive(raa_db_access* raa_current_db,
     int* prank, int* plength, int* pframe, int* pgc, char** pacc, char** pdesc, char** pspecies, char** pseq)
 /*
-   for a sequence identified by name or acc. no. (id != NULL) or by rank
-   returns rank, name, accession, length, frame, acnuc genetic code ID,
+   reads the reply to the oldest getattributes command sent by raa_getattributes_send
+   and returns rank, name, accession, length, frame, acnuc genetic code ID,
    one-line description, species, and full sequence.
    return value: NULL if not found or name (in private memory)
    pacc, pdesc, pspecies and pseq point to private memory upon return
    prank, plength, pframe, pgc, pacc, pdesc, pspecies, pseq can be NULL is no such information is needed
+   pseq must be != NULL iff the full sequence was requested by raa_getattributes_send
  */
 {
-  Reponse* rep;
+  Fields f;
   char* p, * reponse;
   int err;
 
   if (raa_current_db == NULL)
     return NULL;
-  if (id != NULL)
-    sock_printf(raa_current_db, "getattributes&id=%s&seq=%c\n", id, pseq == NULL ? 'F' : 'T');
-  else
-    sock_printf(raa_current_db, "getattributes&rank=%d&seq=%c\n", rank, pseq == NULL ? 'F' : 'T');
   reponse = read_sock(raa_current_db);
   if (reponse == NULL)
   {
     return NULL;
   }
-  rep = initreponse();
-  parse(reponse, rep);
-  p = val(rep, "code");
-  err = atoi(p);
-  free(p);
+  parse_fields(reponse, &f);
+  err = field_int(&f, "code", 1);
   if (err == 0)
   {
     if (prank != NULL)
-    {
-      p = val(rep, "rank");
-      *prank = atoi(p);
-      free(p);
-    }
+      *prank = field_int(&f, "rank", 0);
     if (plength != NULL)
-    {
-      p = val(rep, "length");
-      *plength = atoi(p);
-      free(p);
-    }
+      *plength = field_int(&f, "length", 0);
     if (pframe != NULL)
-    {
-      p = val(rep, "fr");
-      if (p != NULL)
-      {
-        *pframe = atoi(p);
-        free(p);
-      }
-      else
-        *pframe = 0;
-    }
+      *pframe = field_int(&f, "fr", 0);
     if (pgc != NULL)
-    {
-      p = val(rep, "gc");
-      if (p != NULL)
-      {
-        *pgc = atoi(p);
-        free(p);
-      }
-      else
-        *pgc = 0;
-    }
-    p = val(rep, "name");
-    strcpy(raa_current_db->mnemo, p);
-    free(p);
+      *pgc = field_int(&f, "gc", 0);
+    p = field_str(&f, "name");
+    strcpy(raa_current_db->mnemo, p != NULL ? p : "");
     if (pacc != NULL)
     {
-      p = val(rep, "acc");
-      strcpy(raa_current_db->access, p);
-      free(p);
+      p = field_str(&f, "acc");
+      strcpy(raa_current_db->access, p != NULL ? p : "");
       *pacc = raa_current_db->access;
     }
     if (pspecies != NULL)
     {
-      p = val(rep, "spec");
-      strcpy(raa_current_db->species, p);
-      free(p);
+      p = field_str(&f, "spec");
+      strcpy(raa_current_db->species, p != NULL ? p : "");
       *pspecies = raa_current_db->species;
       p = raa_current_db->species;
-      while (*(++p) != 0)
-        *p = tolower(*p);
+      if (*p != 0)
+        while (*(++p) != 0)
+          *p = tolower(*p);
     }
     if (pdesc != NULL)
     {
-      p = val(rep, "descr");
-      strcpy(raa_current_db->descript, p);
-      free(p);
+      p = field_str(&f, "descr");
+      strcpy(raa_current_db->descript, p != NULL ? p : "");
       *pdesc = raa_current_db->descript;
     }
+    /* the fields above point into the socket buffer that read_sock below reuses */
     if (pseq != NULL)
     {
       *pseq = read_sock(raa_current_db);
@@ -3657,7 +5487,6 @@ static char* raa_getattributes_both(raa_db_access* raa_current_db, const char* i
     }
     err = 0;
   }
-  clear_reponse(rep);
   return err ? NULL : raa_current_db->mnemo;
 }
 
@@ -3665,12 +5494,14 @@ static char* raa_getattributes_both(raa_db_access* raa_current_db, const char* i
 char* raa_getattributes(raa_db_access* raa_current_db, const char* id,
     int* prank, int* plength, int* pframe, int* pgc, char** pacc, char** pdesc, char** pspecies, char** pseq)
 {
-  return raa_getattributes_both(raa_current_db, id, 0, prank, plength, pframe, pgc, pacc, pdesc, pspecies, pseq);
+  raa_getattributes_send(raa_current_db, id, 0, pseq != NULL);
+  return raa_getattributes_receive(raa_current_db, prank, plength, pframe, pgc, pacc, pdesc, pspecies, pseq);
 }
 
 
 char* raa_seqrank_attributes(raa_db_access* raa_current_db, int rank,
     int* plength, int* pframe, int* pgc, char** pacc, char** pdesc, char** pspecies, char** pseq)
 {
-  return raa_getattributes_both(raa_current_db, NULL, rank, NULL, plength, pframe, pgc, pacc, pdesc, pspecies, pseq);
+  raa_getattributes_send(raa_current_db, NULL, rank, pseq != NULL);
+  return raa_getattributes_receive(raa_current_db, NULL, plength, pframe, pgc, pacc, pdesc, pspecies, pseq);
 }
@@ -10,8 +10,14 @@
 #include <string.h>
 #include <ctype.h>
 #if defined(WIN32)
-#define SOCKBUFS 8192
+#include <stdint.h>
+typedef uintptr_t raa_socket; /* a SOCKET */
+#else
+typedef int raa_socket;
 #endif
+#define RAA_SOCK_RBSIZE 65536 /* initial size of, and largest read into, the socket input buffer */
+#define RAA_SOCK_WBSIZE 8192 /* initial size of the socket output buffer */
+#define RAA_ZBSIZE 100000 /* size of the compressed input buffer */
 #ifdef __alpha
 typedef long raa_long;
 #define RAA_LONG_FORMAT "%lu"
@@ -34,10 +40,32 @@ struct rlng       /* LONGL series of linked records containing lists of SUBSEQ r
 };
 
 #define RAA_GFRAG_BSIZE 10000
+#define RAA_GFRAG_MAXAHEAD 16 /* max number of blocks read ahead */
+#define RAA_GFRAG_BUDGET 1000000 /* default memory size of the sequence block cache */
+struct gfrag_block /* a block of sequence data in cache */
+{
+  int nseq, index; /* sequence rank and block index: the block begins at position index * RAA_GFRAG_BSIZE + 1 */
+  int lbuf; /* number of residues, < RAA_GFRAG_BSIZE only for the last block of a sequence */
+  int received; /* FALSE while the reply to a block requested ahead was not read */
+  int older, newer; /* neighbours in least recently used order, -1 at ends */
+  int next; /* next slot in hash chain, or in list of free slots */
+  char* buffer;
+};
 struct gfrag_aux
 {
-  char buffer[RAA_GFRAG_BSIZE + 2];
-  int lbuf, nseq_buf, first_buf, l_nseq_buf;
+  struct gfrag_block* blocks; /* NULL or max_blocks cache slots */
+  int max_blocks;
+  int* hash; /* heads of hash_size hash chains of used slots */
+  int hash_size;
+  int free_slot; /* head of list of free slots */
+  int newest, oldest; /* ends of least recently used list of used slots */
+  int last_nseq, last_index; /* last block used, to detect sequential access */
+  int end_nseq, end_length; /* a sequence and its length */
+  size_t budget; /* memory size of the cache, 0 for default */
+  int ahead; /* number of blocks read ahead during sequential access, 0 for none */
+  int pending[RAA_GFRAG_MAXAHEAD]; /* slots of blocks requested ahead and not received, in order of request */
+  int pending_first, ahead_pending;
+  int draining;
 };
 
 struct readsub_aux
@@ -63,6 +91,8 @@ struct readsp_kw_aux
 };
 
 #define BLOCK_ELTS_IN_LIST 500
+#define RAA_LIST_BLOCK 10000 /* # of list elements downloaded at once by raa_nexteltinlist_multiple */
+#define RAA_BIT_WINDOW 1000 /* # of bit1/bit0 commands sent at once by raa_bit_multiple */
 struct nextelt_aux
 {
   int current_rank, previous, total;
@@ -73,11 +103,42 @@ struct nextelt_aux
   int tabdiv[BLOCK_ELTS_IN_LIST];
 };
 
-#define S_BUF_SHRT 5000 /* number of memorized SHORTL records */
+struct raa_elt_block /* consecutive elements of a list, by columns */
+{
+  int count; /* number of elements */
+  int size; /* allocated length of the columns */
+  int* ranks, * lengths, * divs;
+  raa_long* offsets;
+  size_t* name_pos; /* names + name_pos[i] is the null-terminated name of element i */
+  char* names;
+  size_t lnames, names_size; /* used and allocated sizes of names */
+  int last; /* TRUE when the end of the list was met */
+};
+struct raa_elt_request /* a request of raa_elt_block_send, owned by its caller and initially zeroed */
+{
+  int pending; /* number of list elements requested and not read, 0 if none */
+  int stashed; /* TRUE when stash holds a reply read before raa_elt_block_receive was called */
+  struct raa_elt_block stash;
+};
+struct elt_prefetch_aux
+{
+  struct raa_elt_request* outstanding; /* request whose reply is the next one to read, NULL if none */
+  int draining;
+};
+
+#define S_BUF_SHRT 5000 /* default number of memorized SHORTL records */
+struct shrt_record
+{
+  unsigned point; /* SHORTL rank, 0 for a free slot */
+  unsigned val, next;
+};
 struct readshrt_aux
 {
-  unsigned shrt_buffer[S_BUF_SHRT][3]; /* [0]=SHORTL_rank [1]=val [2]=next */
-  int shrt_max, shrt_begin, total;
+  struct shrt_record* table; /* open-addressing hash table of memorized SHORTL records, keyed by point */
+  unsigned mask; /* table size - 1, the table size is a power of 2 */
+  int count; /* number of memorized records */
+  int capacity; /* max number of memorized records, 0 for S_BUF_SHRT */
+  int total;
 };
 
 typedef struct shrt2_list
@@ -96,23 +157,31 @@ struct readsmj_aux
   unsigned* plongs;
 };
 
-typedef struct raa_node
-{
-  char* name;
-  char* libel;
-  char* libel_upcase;
-  int rank;
-  int tid;
-  int count;
-  struct raa_node* parent;
-  struct raa_pair* list_desc;
-  struct raa_node* syno;
-} raa_node;
-struct raa_pair
+typedef struct raa_sp_tree
 {
-  raa_node* value;
-  struct raa_pair* next;
-};
+  int max_sp; /* all arrays are indexed by taxon rank, from 0 to max_sp */
+  int* parent; /* rank of parent taxon, 0 for the root, synonyms and absent taxa */
+  int* first_child; /* rank of first descending taxon, 0 if none */
+  int* next_sibling; /* rank of next taxon with same parent, 0 if none */
+  int* syno; /* next taxon in the closed loop of synonyms, 0 if none */
+  int* tid; /* NCBI taxon ID, 0 if unknown */
+  int* count; /* number of sequences attached to this taxon or below it */
+  int* preorder; /* preorder number of taxon from 1 for the root, 0 for synonyms and unreachable taxa */
+  int* preorder_end; /* largest preorder number in the subtree of taxon */
+  unsigned* name; /* position of taxon name in strings, 0 for absent taxa */
+  unsigned* libel; /* position of taxon label in strings, 0 if none */
+  char* strings; /* all names and labels, each followed by a NUL; strings[0] = 0 */
+  size_t lstrings, strings_size; /* used and allocated sizes of strings */
+  int* name_index; /* open-addressing hash table of taxon ranks keyed by upper-cased name, 0 for free slots */
+  unsigned name_index_mask; /* size of name_index - 1, the size is a power of 2 */
+  int* sorted; /* ranks of all named taxa but the root, in alphabetical order of upper-cased names */
+  int total_sorted; /* number of elements of sorted */
+  void* mapping; /* NULL, or the taxonomy image holding all arrays above (see raa_map_taxonomy) */
+  size_t mapping_size;
+} raa_sp_tree;
+
+#define RAA_SP_NAME(t, rank) ((t)->strings + (t)->name[rank])
+#define RAA_SP_PRESENT(t, rank) ((rank) >= 2 && (rank) <= (t)->max_sp && (t)->name[rank] != 0)
 
 #define WIDTH_MAX 150
 
@@ -122,11 +191,11 @@ typedef enum { raa_sub_of_bib = 0, raa_spec_of_loc, raa_bib_of_loc, raa_aut_of_b
 typedef struct _raa_db_access
 {
   char* dbname;
-  FILE* raa_sockfdr, * raa_sockfdw;
+  raa_socket raa_sockfd;
   int genbank, embl, swissprot, nbrf;
   int nseq, longa, maxa;
   int L_MNEMO, WIDTH_SP, WIDTH_KW, WIDTH_SMJ, WIDTH_AUT, WIDTH_BIB, ACC_LENGTH, SUBINLNG, lrtxt, VALINSHRT2;
-  raa_node** sp_tree; /* NULL or the full taxonomy tree */
+  raa_sp_tree* sp_tree; /* NULL or the full taxonomy tree */
   int max_tid; /* largest correct taxon ID value */
   int* tid_to_rank; /* NULL or tid-to-rank table */
   struct rlng* rlng_buffer;
@@ -136,6 +205,7 @@ typedef struct _raa_db_access
   struct annot_aux annot_data;
   struct readsp_kw_aux readspec_data, readkey_data;
   struct nextelt_aux nextelt_data;
+  struct elt_prefetch_aux elt_prefetch;
   struct readshrt_aux readshrt_data;
   struct shrt2_list* readshrt2_data[raa_acc_of_loc + 1];
   struct readsmj_aux readsmj_data;
@@ -144,16 +214,15 @@ typedef struct _raa_db_access
   int tot_key_annots;
   char** key_annots, ** key_annots_min;
   unsigned char* want_key_annots;
-#ifdef WIN32
-  char sock_input[SOCKBUFS]; /* WIN32 socket input buffer */
-  char* sock_input_pos, * sock_input_end;
-  char sock_output[SOCKBUFS]; /* WIN32 socket output buffer */
-  unsigned sock_output_lbuf;
-#endif
+  char* sock_input; /* socket input buffer, grows to hold the longest line */
+  size_t sock_input_size; /* allocated size of sock_input */
+  size_t sock_input_pos, sock_input_end; /* unread data are sock_input[sock_input_pos .. sock_input_end-1] */
+  char* sock_output; /* commands not sent yet to server */
+  size_t sock_output_size, sock_output_len;
+  void* zlib_channel; /* NULL, or inflater of the compressed reply being read */
+  int zlib_replies; /* TRUE when compressed replies are requested for bulk commands */
   char buffer[5000];
   char remote_file[300];
-  char* full_line;
-  int max_full_line;
   int was_here;
   char* namestr;
   char residuecount[30];
@@ -187,11 +256,23 @@ extern int raa_open_socket(const char* serveurName, int port, const char* client
 extern int raa_opendb(raa_db_access* raa_current_db, const char* db_name);
 int raa_opendb_pw(raa_db_access* raa_current_db, const char* db_name, void* ptr, char* (*getpasswordf)(void*) );
 extern int raa_gfrag(raa_db_access* raa_current_db, int nsub, int first, int lfrag, char* dseq);
+int raa_gfrag_send(raa_db_access* raa_current_db, int nsub, int first, int lfrag);
+char* raa_gfrag_receive_view(raa_db_access* raa_current_db, int* plength);
+int raa_gfrag_receive(raa_db_access* raa_current_db, char* dseq, int maxlen);
+void raa_gfrag_set_ahead(raa_db_access* raa_current_db, int blocks);
+void raa_gfrag_set_budget(raa_db_access* raa_current_db, size_t bytes);
+void raa_gfrag_clear(raa_db_access* raa_current_db);
 extern void raa_acnucclose(raa_db_access* raa_current_db);
 extern int raa_prep_acnuc_query(raa_db_access* raa_current_db);
 extern int raa_proc_query(raa_db_access* raa_current_db, char* query, char** message, char* nomliste, int* numlist,
     int* count, int* locus, int* type);
 int raa_nexteltinlist(raa_db_access* raa_current_db, int first, int lrank, char** pname, int* plength);
+int raa_nexteltinlist_multiple(raa_db_access* raa_current_db, int first, int lrank, int count, int* ranks);
+void raa_elt_block_send(raa_db_access* raa_current_db, struct raa_elt_request* request, int lrank, int first, int count);
+int raa_elt_block_receive(raa_db_access* raa_current_db, struct raa_elt_request* request, struct raa_elt_block* block,
+    int append);
+void raa_elt_request_end(raa_db_access* raa_current_db, struct raa_elt_request* request);
+void raa_elt_block_free(struct raa_elt_block* block);
 int raa_nexteltinlist_annots(raa_db_access* raa_current_db, int first, int lrank, char** pname, int* plength,
     raa_long* paddr, int* pdiv);
 raa_long scan_raa_long(char* txt);
@@ -200,11 +281,13 @@ char* print_raa_long(raa_long val, char* buffer);
 char* raa_read_annots(raa_db_access* raa_current_db, raa_long faddr, int div);
 char* raa_next_annots(raa_db_access* raa_current_db, raa_long* faddr);
 char* raa_translate_cds(raa_db_access* raa_current_db, int seqnum);
+char* raa_translate_cds_seq(raa_db_access* raa_current_db, const char* cds, int length, int gc, int special_init);
 char raa_translate_init_codon(raa_db_access* raa_current_db, int numseq);
 int raa_iknum(raa_db_access* raa_current_db, char* name, raa_file cas);
 int raa_isenum(raa_db_access* raa_current_db, char* name);
 int raa_bcount(raa_db_access* raa_current_db, int lrank);
 void raa_bit1(raa_db_access* raa_current_db, int lrank, int num);
+int raa_bit_multiple(raa_db_access* raa_current_db, int lrank, const int* nums, int count, int value);
 void raa_bit0(raa_db_access* raa_current_db, int lrank, int num);
 int raa_btest(raa_db_access* raa_current_db, int lrank, int num);
 void raa_copylist(raa_db_access* raa_current_db, int from, int to);
@@ -214,6 +297,8 @@ char* raa_getliststate(raa_db_access* raa_current_db, int lrank, int* locus, int
 char* raa_residuecount(raa_db_access* raa_current_db, int lrank);
 int raa_getemptylist(raa_db_access* raa_current_db, char* name);
 int raa_setlistname(raa_db_access* raa_current_db, int lrank, char* name);
+int raa_crelistfromclientdata(raa_db_access* raa_current_db, const char* type, char** items, int count,
+    int* plrank, char** pname);
 int raa_getlistrank(raa_db_access* raa_current_db, char* name);
 int raa_releaselist(raa_db_access* raa_current_db, int lrank);
 int raa_countfilles(raa_db_access* raa_current_db, int lrank);
@@ -233,6 +318,7 @@ char* raa_readacc(raa_db_access* raa_current_db, int num, int* plsub);
 int raa_readext(raa_db_access* raa_current_db, int num, int* mere, int* deb, int* fin);
 int raa_readlng(raa_db_access* raa_current_db, int num);
 unsigned raa_readshrt(raa_db_access* raa_current_db, unsigned point, int* val);
+void raa_readshrt_set_capacity(raa_db_access* raa_current_db, int records);
 unsigned raa_followshrt2(raa_db_access* raa_current_db, int* p_point, int* p_rank, raa_shortl2_kind kind);
 char* raa_ghelp(raa_db_access* raa_current_db, char* fname, char* topic);
 int raa_nextmatchkey(raa_db_access* raa_current_db, int num, char* pattern, char** matching);
@@ -243,7 +329,8 @@ int raa_knowndbs(raa_db_access* raa_current_db, char*** pnames, char*** pdescrip
 char* raa_short_descr(raa_db_access* raa_current_db, int seqnum, char* text, int maxlen, raa_long pinf, int div, char* name);
 void* raa_prep_extract(raa_db_access* raa_current_db, char* format, FILE* outstream, char* choix,
     char* feature_name, char* bornes, char* min_bornes, char** message, int lrank);
-int raa_extract_1_seq(void* opaque);
+int raa_extract_1_seq(void* opaque, char** message);
+void raa_extract_set_sink(void* opaque, void (* sink)(const char* line, size_t l, void* arg), void* arg);
 int raa_extract_interrupt(raa_db_access* raa_current_db, void* opaque);
 void* raa_prep_coordinates(raa_db_access* raa_current_db, int lrank, int seqnum,
     char* operation, /* "simple","fragment","feature","region" */
@@ -252,16 +339,30 @@ int* raa_1_coordinate_set(void*);
 int raa_loadtaxonomy(raa_db_access* raa_current_db, char* rootname,
     int (* progress_function)(int, void*), void* progress_arg,
     int (* need_interrupt_f)(void*), void* interrupt_arg);
+void raa_free_taxonomy(raa_db_access* raa_current_db);
+int raa_sp_count_taxa(raa_sp_tree* tree);
+int raa_sp_major(const raa_sp_tree* tree, int rank);
+int raa_sp_find(const raa_sp_tree* tree, const char* name);
+int raa_sp_match(const raa_sp_tree* tree, const char* pattern, int maxcount, int** pranks);
+int raa_save_taxonomy(raa_db_access* raa_current_db, const char* path);
+int raa_map_taxonomy(raa_db_access* raa_current_db, const char* path);
 char* raa_get_taxon_info(raa_db_access* raa_current_db, char* name, int rank, int tid, int* p_rank,
-    int* p_tid, int* p_parent, struct raa_pair** p_desc_list);
+    int* p_tid, int* p_parent, int* p_first_child);
 char* raa_getattributes(raa_db_access* raa_current_db, const char* id,
     int* prank, int* plength, int* pframe, int* pgc, char** pacc, char** pdesc, char** pspecies, char** pseq);
 char* raa_seqrank_attributes(raa_db_access* raa_current_db, int rank,
     int* plength, int* pframe, int* pgc, char** pacc, char** pdesc, char** pspecies, char** pseq);
+void raa_getattributes_send(raa_db_access* raa_current_db, const char* id, int rank, int wantseq);
+char* raa_getattributes_receive(raa_db_access* raa_current_db,
+    int* prank, int* plength, int* pframe, int* pgc, char** pacc, char** pdesc, char** pspecies, char** pseq);
 
 int sock_fputs(raa_db_access* raa_current_db, const char* line);
 int sock_flush(raa_db_access* raa_current_db);
 char* read_sock(raa_db_access* raa_current_db);
+char* read_sock_len(raa_db_access* raa_current_db, size_t* plength);
+int raa_zlib_open(raa_db_access* raa_current_db);
+void raa_zlib_close(raa_db_access* raa_current_db);
+void raa_set_zlib(raa_db_access* raa_current_db, int on);
 
 
 int trim_key(char* name); /* remove trailing spaces */
@@ -269,6 +370,10 @@ void majuscules(char* name);
 int atoi_u(const char* p);
 void compact(char* chaine);
 int strcmptrail(char* s1, int l1, char* s2, int l2);
+/* translates the n / 3 codons of nt, from its first base, with acnuc genetic code gc (the regular code
+   if unknown) into out, without trailing null; out can be equal to nt; codons with a base other than
+   ACGTU give X; returns the number of amino acids; needs no server connection and is thread-safe */
+size_t translate_nucleotides(const char* nt, size_t n, int gc, char* out);
 
 
 #endif /* RAA_ACNUC_H  */
@@ -0,0 +1,162 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include "RaaAsync.h"
+
+#include <exception>
+
+using namespace std;
+using namespace bpp;
+
+/* largest number of getSeq() requests sent to the server as one pipelined batch */
+#define MAX_SEQ_BATCH 1000
+
+RaaAsync::RaaAsync(RAA& raa, unsigned int window) :
+  raa(raa), window(window), requests(), stopping(false), mutex(), submitted(), worker()
+{
+  worker = thread(&RaaAsync::run, this);
+}
+
+
+RaaAsync::~RaaAsync()
+{
+  {
+    lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  submitted.notify_one();
+  worker.join();
+}
+
+
+void RaaAsync::submit(Request&& request)
+{
+  {
+    lock_guard<std::mutex> lock(mutex);
+    requests.push_back(move(request));
+  }
+  submitted.notify_one();
+}
+
+
+future<unique_ptr<Sequence> > RaaAsync::getSeq(int seqrank, int maxlength)
+{
+  Request request;
+  request.seq = make_shared<SeqRequest>();
+  request.seq->rank = seqrank;
+  request.seq->maxlength = maxlength;
+  auto result = request.seq->result.get_future();
+  submit(move(request));
+  return result;
+}
+
+
+future<unique_ptr<RaaSeqAttributes> > RaaAsync::getAttributes(int seqrank)
+{
+  auto task = make_shared<packaged_task<unique_ptr<RaaSeqAttributes>()> >(
+        [this, seqrank]() { return raa.getAttributes(seqrank); });
+  Request request;
+  request.task = [task]() { (*task)(); };
+  auto result = task->get_future();
+  submit(move(request));
+  return result;
+}
+
+
+future<string> RaaAsync::getSeqFrag(int seqrank, int first, int length)
+{
+  auto task = make_shared<packaged_task<string()> >(
+        [this, seqrank, first, length]() {
+          string sequence;
+          raa.getSeqFrag(seqrank, first, length, sequence);
+          return sequence;
+        });
+  Request request;
+  request.task = [task]() { (*task)(); };
+  auto result = task->get_future();
+  submit(move(request));
+  return result;
+}
+
+
+future<unique_ptr<RaaList> > RaaAsync::processQuery(const string& query, const string& listname)
+{
+  auto task = make_shared<packaged_task<unique_ptr<RaaList>()> >(
+        [this, query, listname]() { return raa.processQuery(query, listname); });
+  Request request;
+  request.task = [task]() { (*task)(); };
+  auto result = task->get_future();
+  submit(move(request));
+  return result;
+}
+
+
+void RaaAsync::run()
+{
+  vector<shared_ptr<SeqRequest> > batch;
+  function<void()> task;
+
+  while (true)
+  {
+    {
+      unique_lock<std::mutex> lock(mutex);
+      submitted.wait(lock, [this] { return stopping || !requests.empty(); });
+      if (requests.empty())
+        return;
+      // take either one request, or all consecutive getSeq() requests with the same maxlength
+      if (requests.front().seq)
+      {
+        int maxlength = requests.front().seq->maxlength;
+        while (!requests.empty() && requests.front().seq && requests.front().seq->maxlength == maxlength &&
+               batch.size() < MAX_SEQ_BATCH)
+        {
+          batch.push_back(requests.front().seq);
+          requests.pop_front();
+        }
+      }
+      else
+      {
+        task = move(requests.front().task);
+        requests.pop_front();
+      }
+    }
+    if (batch.empty())
+    {
+      task();
+      task = nullptr;
+    }
+    else
+    {
+      runSeqRequests(batch);
+      batch.clear();
+    }
+  }
+}
+
+
+void RaaAsync::runSeqRequests(vector<shared_ptr<SeqRequest> >& batch)
+{
+  vector<int> ranks;
+  vector<unique_ptr<Sequence> > seqs;
+  for (auto& request : batch)
+  {
+    ranks.push_back(request->rank);
+  }
+  try
+  {
+    raa.getSeqs_pipelined(ranks, batch[0]->maxlength, window, seqs);
+  }
+  catch (...)
+  {
+    for (auto& request : batch)
+    {
+      request->result.set_exception(current_exception());
+    }
+    return;
+  }
+  for (size_t i = 0; i < batch.size(); i++)
+  {
+    batch[i]->result.set_value(move(seqs[i]));
+  }
+}
@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef _RAAASYNC_H_
+#define _RAAASYNC_H_
+
+#include "RAA.h"
+
+// From the STL:
+#include <string>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+
+namespace bpp
+{
+/**
+ * @brief Asynchronous access to a database: requests return immediately with a std::future.
+ *
+ * A background thread owns the database connection and processes requests in their order of submission.
+ * Consecutive getSeq() requests are sent to the server as one pipelined batch (see RAA::getSeqs()), so that
+ * submitting many of them in a row is not limited by the network round trip time. Meanwhile, the calling
+ * thread can work on previously obtained results.
+ *
+ * Usage example:
+ * @code
+   RAA raa("embl");
+   RaaAsync async(raa);
+   std::vector<std::future<std::unique_ptr<Sequence> > > seqs;
+   for (int rank : ranks)
+     seqs.push_back(async.getSeq(rank));
+   for (auto& seq : seqs)
+     align(seq.get());
+ * @endcode
+ */
+class RaaAsync
+{
+public:
+  /**
+   * @brief Starts the background thread working on a database connection.
+   *
+   * @param raa     An open database connection. It must not be used otherwise while this object exists.
+   * @param window  The maximum number of commands sent to the server ahead of their replies
+   * when processing consecutive getSeq() requests.
+   */
+  RaaAsync(RAA& raa, unsigned int window = 50);
+
+  RaaAsync(const RaaAsync&) = delete;
+  RaaAsync& operator=(const RaaAsync&) = delete;
+
+  /**
+   * @brief Completes all submitted requests and stops the background thread.
+   */
+  ~RaaAsync();
+
+  /**
+   * @brief Asynchronous version of RAA::getSeq(int, int).
+   */
+  std::future<std::unique_ptr<Sequence> > getSeq(int seqrank, int maxlength = 100000);
+
+  /**
+   * @brief Asynchronous version of RAA::getAttributes(int).
+   */
+  std::future<std::unique_ptr<RaaSeqAttributes> > getAttributes(int seqrank);
+
+  /**
+   * @brief Asynchronous version of RAA::getSeqFrag(int, int, int, std::string&).
+   *
+   * @return   The requested sequence data, empty if impossible.
+   */
+  std::future<std::string> getSeqFrag(int seqrank, int first, int length);
+
+  /**
+   * @brief Asynchronous version of RAA::processQuery().
+   *
+   * The future rethrows the error message string if the query fails.
+   * The list obtained belongs to the connection used by the background thread: its getRank(),
+   * getName() and getType() can be called at once, but any call that reaches the server (getSize(),
+   * iteration, materialize(), ...) is possible only after this object was destroyed.
+   */
+  std::future<std::unique_ptr<RaaList> > processQuery(const std::string& query, const std::string& listname);
+
+private:
+  struct SeqRequest
+  {
+    int rank;
+    int maxlength;
+    std::promise<std::unique_ptr<Sequence> > result;
+  };
+
+  struct Request
+  {
+    std::shared_ptr<SeqRequest> seq; // a getSeq() request, or
+    std::function<void()> task;      // any other request
+  };
+
+  RAA& raa;
+  unsigned int window;
+  std::deque<Request> requests;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable submitted;
+  std::thread worker;
+
+  void submit(Request&& request);
+  void run();
+  void runSeqRequests(std::vector<std::shared_ptr<SeqRequest> >& batch);
+};
+} // end of namespace bpp.
+
+#endif // _RAAASYNC_H_
@@ -0,0 +1,169 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include "RaaBitset.h"
+
+#include <string>
+
+using namespace std;
+using namespace bpp;
+
+static inline int popcount64(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_popcountll(w);
+#else
+  w = w - ((w >> 1) & 0x5555555555555555ULL);
+  w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+  w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (int)((w * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+
+static inline int lowest_bit(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(w);
+#else
+  int n = 0;
+  while (!(w & 1))
+  {
+    w >>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+
+RaaBitset::RaaBitset(int maxrank) : maxrank(maxrank < 0 ? 0 : maxrank), words(this->maxrank / 64 + 1, 0) {}
+
+
+void RaaBitset::set(int rank)
+{
+  if (rank <= 0 || rank > maxrank)
+    throw string("Rank out of bitset bounds");
+  words[rank >> 6] |= (uint64_t)1 << (rank & 63);
+}
+
+
+void RaaBitset::reset(int rank)
+{
+  if (rank > 0 && rank <= maxrank)
+    words[rank >> 6] &= ~((uint64_t)1 << (rank & 63));
+}
+
+
+void RaaBitset::clear()
+{
+  words.assign(words.size(), 0);
+}
+
+
+int RaaBitset::count() const
+{
+  int total = 0;
+  for (uint64_t w : words)
+  {
+    total += popcount64(w);
+  }
+  return total;
+}
+
+
+int RaaBitset::next(int rank) const
+{
+  if (rank < 0)
+    rank = 0;
+  if (rank >= maxrank)
+    return 0;
+  rank++;
+  size_t i = rank >> 6;
+  uint64_t w = words[i] & (~(uint64_t)0 << (rank & 63));
+  while (w == 0)
+  {
+    if (++i >= words.size())
+      return 0;
+    w = words[i];
+  }
+  return (int)(i * 64 + lowest_bit(w));
+}
+
+
+vector<int> RaaBitset::toVector() const
+{
+  vector<int> ranks;
+  ranks.reserve(count());
+  for (size_t i = 0; i < words.size(); i++)
+  {
+    uint64_t w = words[i];
+    while (w != 0)
+    {
+      ranks.push_back((int)(i * 64 + lowest_bit(w)));
+      w &= w - 1;
+    }
+  }
+  return ranks;
+}
+
+
+void RaaBitset::checkSize(const RaaBitset& other) const
+{
+  if (other.maxrank != maxrank)
+    throw string("Bitsets of different sizes");
+}
+
+
+// the loops below are written so that the compiler vectorizes them
+RaaBitset& RaaBitset::operator&=(const RaaBitset& other)
+{
+  checkSize(other);
+  uint64_t* w = words.data();
+  const uint64_t* o = other.words.data();
+  for (size_t i = 0, n = words.size(); i < n; i++)
+  {
+    w[i] &= o[i];
+  }
+  return *this;
+}
+
+
+RaaBitset& RaaBitset::operator|=(const RaaBitset& other)
+{
+  checkSize(other);
+  uint64_t* w = words.data();
+  const uint64_t* o = other.words.data();
+  for (size_t i = 0, n = words.size(); i < n; i++)
+  {
+    w[i] |= o[i];
+  }
+  return *this;
+}
+
+
+RaaBitset& RaaBitset::operator^=(const RaaBitset& other)
+{
+  checkSize(other);
+  uint64_t* w = words.data();
+  const uint64_t* o = other.words.data();
+  for (size_t i = 0, n = words.size(); i < n; i++)
+  {
+    w[i] ^= o[i];
+  }
+  return *this;
+}
+
+
+RaaBitset& RaaBitset::andNot(const RaaBitset& other)
+{
+  checkSize(other);
+  uint64_t* w = words.data();
+  const uint64_t* o = other.words.data();
+  for (size_t i = 0, n = words.size(); i < n; i++)
+  {
+    w[i] &= ~o[i];
+  }
+  return *this;
+}
@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef _RAABITSET_H_
+#define _RAABITSET_H_
+
+// From the STL:
+#include <vector>
+#include <cstdint>
+
+namespace bpp
+{
+/**
+ * @brief Local copy of the content of a list of sequences, species or keywords, as one bit per database rank.
+ *
+ * Instances are typically obtained from RaaList::materialize(), and then allow testing membership and
+ * combining lists without any exchange with the database server. Set operations process 64 ranks at a time.
+ *
+ * Usage example:
+ * @code
+   std::unique_ptr<RaaList> cds = mydb->processQuery("t=cds", "cds");
+   std::unique_ptr<RaaList> human = mydb->processQuery("sp=homo sapiens", "human");
+   RaaBitset humancds = cds->materialize() & human->materialize();
+   for (int rank = humancds.first(); rank != 0; rank = humancds.next(rank)) {
+     // ...
+   }
+ * @endcode
+ */
+class RaaBitset
+{
+  int maxrank;
+  std::vector<uint64_t> words;
+
+public:
+  /**
+   * @brief Builds an empty set able to contain database ranks from 1 to maxrank.
+   */
+  RaaBitset(int maxrank = 0);
+
+  /**
+   * @brief Gives the largest database rank the set can contain.
+   */
+  int maxRank() const { return maxrank; }
+
+  /**
+   * @brief Tests whether a database rank belongs to the set.
+   */
+  bool test(int rank) const
+  {
+    return rank > 0 && rank <= maxrank && (words[rank >> 6] >> (rank & 63)) & 1;
+  }
+
+  /**
+   * @brief Adds a database rank to the set.
+   *
+   * @throw string if rank is outside the set bounds.
+   */
+  void set(int rank);
+
+  /**
+   * @brief Removes a database rank from the set.
+   */
+  void reset(int rank);
+
+  /**
+   * @brief Removes all elements from the set.
+   */
+  void clear();
+
+  /**
+   * @brief Gives the number of elements of the set.
+   */
+  int count() const;
+
+  /**
+   * @brief Gives the smallest database rank in the set, or 0 if the set is empty.
+   */
+  int first() const { return next(0); }
+
+  /**
+   * @brief Gives the smallest database rank in the set larger than rank, or 0 if there is none.
+   */
+  int next(int rank) const;
+
+  /**
+   * @brief Puts all elements of the set, in increasing order, in a vector.
+   */
+  std::vector<int> toVector() const;
+
+  /**
+   * @name Set operations between sets of the same maximum rank.
+   *
+   * @throw string if both sets don't have the same maximum rank.
+   * @{
+   */
+  RaaBitset& operator&=(const RaaBitset& other);
+  RaaBitset& operator|=(const RaaBitset& other);
+  RaaBitset& operator^=(const RaaBitset& other);
+
+  /**
+   * @brief Removes from the set all elements of other.
+   */
+  RaaBitset& andNot(const RaaBitset& other);
+
+  bool operator==(const RaaBitset& other) const { return maxrank == other.maxrank && words == other.words; }
+  bool operator!=(const RaaBitset& other) const { return !(*this == other); }
+  /** @} */
+
+private:
+  void checkSize(const RaaBitset& other) const;
+};
+
+inline RaaBitset operator&(RaaBitset a, const RaaBitset& b) { return a &= b; }
+inline RaaBitset operator|(RaaBitset a, const RaaBitset& b) { return a |= b; }
+inline RaaBitset operator^(RaaBitset a, const RaaBitset& b) { return a ^= b; }
+} // end of namespace bpp.
+
+#endif // _RAABITSET_H_
@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#include "RaaConnectionPool.h"
+
+#include <atomic>
+#include <thread>
+#include <exception>
+
+using namespace std;
+using namespace bpp;
+
+RaaConnectionPool::Lease::~Lease()
+{
+  if (raa != nullptr)
+    pool->release(raa);
+}
+
+
+RaaConnectionPool::RaaConnectionPool(const string& dbname, unsigned int size, int port, const string& server,
+    char* (*getpasswordf)(void*), void* p)
+{
+  if (size == 0)
+    size = 1;
+  for (unsigned int i = 0; i < size; i++)
+  {
+    unique_ptr<RAA> raa(new RAA(port, server));
+    int err = raa->openDatabase(dbname, getpasswordf, p);
+    if (err)
+      throw err;
+    available.push_back(raa.get());
+    connections.push_back(move(raa));
+  }
+}
+
+
+RaaConnectionPool::~RaaConnectionPool() = default;
+
+
+RaaConnectionPool::Lease RaaConnectionPool::acquire()
+{
+  unique_lock<std::mutex> lock(mutex);
+  released.wait(lock, [this] { return !available.empty(); });
+  RAA* raa = available.back();
+  available.pop_back();
+  return Lease(this, raa);
+}
+
+
+void RaaConnectionPool::release(RAA* raa)
+{
+  {
+    lock_guard<std::mutex> lock(mutex);
+    available.push_back(raa);
+  }
+  released.notify_one();
+}
+
+
+void RaaConnectionPool::parallelFor(RaaList& list, const function<void(RAA&, int)>& f)
+{
+  vector<int> ranks;
+  for (int rank = list.firstElement(); rank != 0; rank = list.nextElement())
+  {
+    ranks.push_back(rank);
+  }
+  parallelFor(ranks, f);
+}
+
+
+void RaaConnectionPool::parallelFor(const vector<int>& ranks, const function<void(RAA&, int)>& f)
+{
+  const size_t chunk = 16;
+  atomic<size_t> next(0);
+  exception_ptr error;
+  std::mutex error_mutex;
+  vector<thread> workers;
+
+  auto work = [&]() {
+        Lease raa = acquire();
+        size_t first;
+        while ((first = next.fetch_add(chunk)) < ranks.size())
+        {
+          size_t last = min(first + chunk, ranks.size());
+          for (size_t i = first; i < last; i++)
+          {
+            try
+            {
+              f(*raa, ranks[i]);
+            }
+            catch (...)
+            {
+              lock_guard<std::mutex> lock(error_mutex);
+              if (!error)
+                error = current_exception();
+              next = ranks.size();
+              return;
+            }
+          }
+        }
+      };
+  size_t nthreads = min((size_t)connections.size(), (ranks.size() + chunk - 1) / chunk);
+  for (size_t i = 0; i < nthreads; i++)
+  {
+    workers.push_back(thread(work));
+  }
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+  if (error)
+    rethrow_exception(error);
+}
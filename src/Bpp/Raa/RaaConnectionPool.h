@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: The Bio++ Development Group
+//
+// SPDX-License-Identifier: CECILL-2.1
+
+#ifndef _RAACONNECTIONPOOL_H_
+#define _RAACONNECTIONPOOL_H_
+
+#include "RAA.h"
+
+// From the STL:
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace bpp
+{
+/**
+ * @brief A set of network connections to the same database, for use by several threads.
+ *
+ * An RAA object keeps all its session state in its network connection, and thus can be used by a single
+ * thread at a time. A pool opens several connections to the same database and lends them to worker threads,
+ * so that independent requests to a latency-bound server are processed in parallel.
+ *
+ * Usage example:
+ * @code
+   RaaConnectionPool pool("embl", 8);
+   std::unique_ptr<RaaList> list;
+   {
+     RaaConnectionPool::Lease raa = pool.acquire();
+     list = raa->processQuery("sp=felis catus and t=cds", "mylist");
+   } // the lease is returned here, before parallelFor() needs all connections
+   pool.parallelFor(*list, [](RAA& db, int rank) {
+     std::unique_ptr<Sequence> seq = db.getSeq(rank);
+     // ...
+   });
+ * @endcode
+ */
+class RaaConnectionPool
+{
+public:
+  /**
+   * @brief Exclusive use of one connection of a pool, returned to the pool upon destruction.
+   */
+  class Lease
+  {
+    friend class RaaConnectionPool;
+    RaaConnectionPool* pool;
+    RAA* raa;
+
+    Lease(RaaConnectionPool* pool, RAA* raa) : pool(pool), raa(raa) {}
+
+public:
+    Lease(Lease&& other) : pool(other.pool), raa(other.raa) { other.raa = nullptr; }
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    ~Lease();
+
+    /**
+     * @brief Gives the leased database connection.
+     */
+    RAA* get() { return raa; }
+    RAA* operator->() { return raa; }
+    RAA& operator*() { return *raa; }
+  };
+
+  /**
+   * @brief Opens several network connections to a database.
+   *
+   * @param dbname       The database name (e.g., "embl", "genbank", "swissprot").
+   * @param size         The number of connections to open.
+   * @param port         The IP port number of the server.
+   * @param server       The IP name of the server.
+   * @param getpasswordf NULL, or, for a password-protected database, pointer to a password-providing function
+   * (see RAA::openDatabase()). It is called once for each connection.
+   * @param p            NULL, or pointer to data transmitted as argument of getpasswordf.
+   * @throw int    An error code as for the RAA constructors and RAA::openDatabase().
+   */
+  RaaConnectionPool(const std::string& dbname, unsigned int size, int port = 5558,
+      const std::string& server = "pbil.univ-lyon1.fr", char* (*getpasswordf)(void*) = NULL, void* p = NULL);
+
+  RaaConnectionPool(const RaaConnectionPool&) = delete;
+  RaaConnectionPool& operator=(const RaaConnectionPool&) = delete;
+
+  /**
+   * @brief Closes all connections of the pool. All leases must have been returned before.
+   */
+  ~RaaConnectionPool();
+
+  /**
+   * @brief Gives the number of connections of the pool.
+   */
+  unsigned int size() { return (unsigned int)connections.size(); }
+
+  /**
+   * @brief Obtains the exclusive use of one connection, waiting until one is available.
+   */
+  Lease acquire();
+
+  /**
+   * @brief Applies a function to all elements of a list, using all connections of the pool in parallel.
+   *
+   * Elements of the list are first enumerated using the list's own connection, which must not be leased
+   * at that time by another thread. They are then processed by one thread per connection of the pool.
+   * Elements are not processed in any particular order.
+   * The calling thread must not hold any lease of the pool: its connection would stay unused, and with a
+   * pool of one connection the call would never return.
+   *
+   * @param list   A list of database elements (often sequences).
+   * @param f      The function called for each element, with a leased connection and the database rank of the element.
+   * @throw Any exception thrown by f, once all threads have stopped.
+   */
+  void parallelFor(RaaList& list, const std::function<void(RAA&, int)>& f);
+
+  /**
+   * @brief Applies a function to several database ranks, using all connections of the pool in parallel.
+   *
+   * As for the other parallelFor(), the calling thread must not hold any lease of the pool.
+   *
+   * @param ranks  Database ranks of elements (often sequences).
+   * @param f      The function called for each element, with a leased connection and the database rank of the element.
+   * @throw Any exception thrown by f, once all threads have stopped.
+   */
+  void parallelFor(const std::vector<int>& ranks, const std::function<void(RAA&, int)>& f);
+
+private:
+  std::vector<std::unique_ptr<RAA> > connections;
+  std::vector<RAA*> available;
+  std::mutex mutex;
+  std::condition_variable released;
+
+  void release(RAA* raa);
+};
+} // end of namespace bpp.
+
+#endif // _RAACONNECTIONPOOL_H_
@@ -16,6 +16,8 @@ RaaList::RaaList()
 
 int RaaList::getCount(void)
 {
+  if (bits)
+    return bits->count();
   return raa_bcount(myraa->raa_data, rank);
 }
 
@@ -61,6 +63,8 @@ string RaaList::residueCount()
 void RaaList::addElement(int elt_rank)
 {
   raa_bit1(myraa->raa_data, rank, elt_rank);
+  if (bits && elt_rank > 0 && elt_rank <= bits->maxRank())
+    bits->set(elt_rank);
 }
 
 
@@ -77,21 +81,236 @@ bool RaaList::parentsOnly(void)
 void RaaList::removeElement(int elt_rank)
 {
   raa_bit0(myraa->raa_data, rank, elt_rank);
+  if (bits)
+    bits->reset(elt_rank);
+}
+
+
+void RaaList::addElements(const vector<int>& ranks)
+{
+  if (raa_bit_multiple(myraa->raa_data, rank, ranks.data(), (int)ranks.size(), TRUE) != 0)
+  {
+    // some elements may have been added: the local copy can no longer be trusted
+    bits.reset();
+    throw string("Cannot add elements to list ") + name;
+  }
+  if (bits)
+  {
+    for (int elt_rank : ranks)
+    {
+      if (elt_rank > 0 && elt_rank <= bits->maxRank())
+        bits->set(elt_rank);
+    }
+  }
+}
+
+
+void RaaList::removeElements(const vector<int>& ranks)
+{
+  if (raa_bit_multiple(myraa->raa_data, rank, ranks.data(), (int)ranks.size(), FALSE) != 0)
+  {
+    bits.reset();
+    throw string("Cannot remove elements from list ") + name;
+  }
+  if (bits)
+  {
+    for (int elt_rank : ranks)
+    {
+      bits->reset(elt_rank);
+    }
+  }
 }
 
 
 void RaaList::zeroList(void)
 {
   raa_zerolist(myraa->raa_data, rank);
+  if (bits)
+    bits->clear();
 }
 
 
 bool RaaList::isInList(int elt_rank)
 {
+  if (bits)
+    return bits->test(elt_rank);
   return (bool)raa_btest(myraa->raa_data, rank, elt_rank);
 }
 
 
+RaaListColumns RaaList::fetchColumns(int blocksize)
+{
+  raa_db_access* raa_data = myraa->raa_data;
+  struct raa_elt_request request = {};
+  struct raa_elt_block block = {};
+  RaaListColumns columns;
+  int count;
+
+  if (blocksize <= 0)
+    blocksize = RAA_LIST_BLOCK;
+  raa_elt_block_send(raa_data, &request, rank, 1, blocksize);
+  while (true)
+  {
+    count = raa_elt_block_receive(raa_data, &request, &block, FALSE);
+    if (count < 0)
+    {
+      raa_elt_request_end(raa_data, &request);
+      raa_elt_block_free(&block);
+      throw string("Cannot obtain the elements of list ") + name;
+    }
+    bool more = count == blocksize && !block.last;
+    if (more)
+      raa_elt_block_send(raa_data, &request, rank, block.ranks[count - 1], blocksize);
+    // the server prepares the next block while this one is appended
+    uint64_t base = columns.names.size();
+    columns.ranks.insert(columns.ranks.end(), block.ranks, block.ranks + count);
+    columns.lengths.insert(columns.lengths.end(), block.lengths, block.lengths + count);
+    columns.divs.insert(columns.divs.end(), block.divs, block.divs + count);
+    columns.offsets.insert(columns.offsets.end(), block.offsets, block.offsets + count);
+    for (int i = 0; i < count; i++)
+    {
+      columns.nameOffsets.push_back(base + block.name_pos[i]);
+    }
+    columns.names.insert(columns.names.end(), block.names, block.names + block.lnames);
+    if (!more)
+      break;
+  }
+  raa_elt_request_end(raa_data, &request);
+  raa_elt_block_free(&block);
+  return columns;
+}
+
+
+const RaaBitset& RaaList::materialize()
+{
+  raa_db_access* raa_data = myraa->raa_data;
+  auto local = make_unique<RaaBitset>(*type == RaaList::LIST_SEQUENCES ? raa_data->nseq : raa_data->maxa);
+  vector<int> block(RAA_LIST_BLOCK);
+  int last = 1, count;
+  do
+  {
+    count = raa_nexteltinlist_multiple(raa_data, last, rank, RAA_LIST_BLOCK, block.data());
+    if (count < 0)
+      throw string("Cannot obtain the elements of list ") + name;
+    for (int i = 0; i < count; i++)
+    {
+      local->set(block[i]);
+    }
+    if (count > 0)
+      last = block[count - 1];
+  }
+  while (count == RAA_LIST_BLOCK);
+  bits = move(local);
+  return *bits;
+}
+
+
+struct RaaList::const_iterator::Cursor
+{
+  raa_db_access* raa_data;
+  int lrank;
+  string name;
+  int blocksize;
+  struct raa_elt_request request;
+  struct raa_elt_block block;
+  int pos;
+  bool requested;
+  RaaListElement element;
+
+  Cursor(raa_db_access* raa_data, int lrank, const string& name, int blocksize) :
+    raa_data(raa_data), lrank(lrank), name(name), blocksize(blocksize), request(), block(), pos(0),
+    requested(false), element()
+  {
+    raa_elt_block_send(raa_data, &request, lrank, 1, blocksize);
+    requested = true;
+    load();
+  }
+
+  ~Cursor()
+  {
+    // the reply to a pending request must be read before the connection can be used again
+    raa_elt_request_end(raa_data, &request);
+    raa_elt_block_free(&block);
+  }
+
+  // receives the requested block and immediately requests the next one
+  bool load()
+  {
+    int count = raa_elt_block_receive(raa_data, &request, &block, FALSE);
+    requested = false;
+    pos = 0;
+    if (count < 0)
+    {
+      // the destructor doesn't run when the constructor throws
+      raa_elt_request_end(raa_data, &request);
+      raa_elt_block_free(&block);
+      throw string("Cannot obtain the elements of list ") + name;
+    }
+    if (count == 0)
+    {
+      block.count = 0;
+      return false;
+    }
+    if (!block.last && count == blocksize)
+    {
+      raa_elt_block_send(raa_data, &request, lrank, block.ranks[count - 1], blocksize);
+      requested = true;
+    }
+    setElement();
+    return true;
+  }
+
+  void setElement()
+  {
+    element.rank = block.ranks[pos];
+    element.name = block.names + block.name_pos[pos];
+    element.length = block.lengths[pos];
+    element.offset = block.offsets[pos];
+    element.div = block.divs[pos];
+  }
+
+  bool atEnd() const { return pos >= block.count; }
+
+  void advance()
+  {
+    if (++pos < block.count)
+      setElement();
+    else if (requested)
+      load();
+  }
+};
+
+
+const RaaListElement& RaaList::const_iterator::operator*() const
+{
+  return cursor->element;
+}
+
+
+RaaList::const_iterator& RaaList::const_iterator::operator++()
+{
+  cursor->advance();
+  if (cursor->atEnd())
+    cursor.reset();
+  return *this;
+}
+
+
+bool RaaList::const_iterator::operator==(const const_iterator& other) const
+{
+  return cursor == other.cursor;
+}
+
+
+RaaList::const_iterator RaaList::Range::begin() const
+{
+  auto cursor = make_shared<const_iterator::Cursor>(list->myraa->raa_data, list->rank, list->name, blocksize);
+  if (cursor->atEnd())
+    return const_iterator();
+  return const_iterator(cursor);
+}
+
+
 RaaList* RaaList::modifyByLength(const string& criterion, const string& listname)
 {
   int err, newlistrank;
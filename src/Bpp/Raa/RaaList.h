@@ -4,12 +4,55 @@
 
 #ifndef _RAALIST_H_
 #define _RAALIST_H_
+extern "C" {
+#include "RAA_acnuc.h"
+}
+
+// From the STL:
 #include <string>
+#include <memory>
+#include <vector>
+#include <iterator>
+#include <cstdint>
+
+#include "RaaBitset.h"
 
 namespace bpp
 {
 class RAA;
 
+/**
+ * @brief Description of an element of a list, as obtained by iterating over an RaaList.
+ */
+struct RaaListElement
+{
+  int rank; /*!< database rank of the element */
+  const char* name; /*!< name of the element, valid until the next block of the list is loaded */
+  int length; /*!< sequence length (meaningful only for sequence lists) */
+  raa_long offset; /*!< offset of the first annotation line within its database file (sequence lists) */
+  int div; /*!< rank of the database file containing the annotations (sequence lists) */
+};
+
+/**
+ * @brief Description of all elements of a list, by columns, as obtained by RaaList::fetchColumns().
+ *
+ * Element i has database rank ranks[i], name names.data() + nameOffsets[i] (null-terminated), and,
+ * for sequence lists, length lengths[i] and annotations beginning at offset offsets[i]
+ * of database file divs[i]. Elements are in increasing rank order.
+ */
+struct RaaListColumns
+{
+  std::vector<int32_t> ranks;
+  std::vector<int32_t> lengths;
+  std::vector<int32_t> divs;
+  std::vector<int64_t> offsets;
+  std::vector<uint64_t> nameOffsets;
+  std::vector<char> names; /*!< all names, each followed by a null character */
+
+  size_t size() const { return ranks.size(); }
+  const char* name(size_t i) const { return names.data() + nameOffsets[i]; }
+};
+
 /**
  * @brief List of sequences, keywords, or species returned by a database query.
  *
@@ -27,6 +70,7 @@ class RaaList
   int from;
   std::string elementname;
   int elementlength;
+  std::unique_ptr<RaaBitset> bits;
 
 public:
   /**
@@ -44,8 +88,80 @@ public:
    */
   static const std::string LIST_SPECIES;
 
+  /**
+   * @brief Input iterator over the elements of a list, see elements().
+   */
+  class const_iterator
+  {
+    friend class RaaList;
+    struct Cursor;
+    std::shared_ptr<Cursor> cursor;
+
+    const_iterator(std::shared_ptr<Cursor> c) : cursor(c) {}
+
+public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef RaaListElement value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const RaaListElement* pointer;
+    typedef const RaaListElement& reference;
+
+    const_iterator() {}
+    const RaaListElement& operator*() const;
+    const RaaListElement* operator->() const { return &**this; }
+    const_iterator& operator++();
+    bool operator==(const const_iterator& other) const;
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+  };
+
+  /**
+   * @brief Elements of a list, in increasing rank order, as a range for use in range-based for loops.
+   */
+  class Range
+  {
+    friend class RaaList;
+    RaaList* list;
+    int blocksize;
+
+    Range(RaaList* list, int blocksize) : list(list), blocksize(blocksize) {}
+
+public:
+    const_iterator begin() const;
+    const_iterator end() const { return const_iterator(); }
+  };
+
+  /**
+   * @brief Gives the elements of the list, for iteration in a range-based for loop.
+   *
+   * Elements are obtained from the server by blocks. As soon as a block is received, the next block
+   * is requested, so that the server prepares it while the current block is processed. Other database
+   * operations are allowed inside the loop, including other iterations and fetchColumns(); they wait for
+   * the reply to the pending request, which is kept for this iteration.
+   * The list and its database must not be deleted, and the list content not be modified, during iteration.
+   * A string is thrown, when the iterator is created or advanced, if elements can't be obtained from the server.
+   *
+   * Usage example:
+   * @code
+     std::unique_ptr<RaaList> list = mydb->processQuery("sp=felis catus and t=cds", "mylist");
+     for (const RaaListElement& elt : list->elements()) {
+       std::cout << elt.rank << " " << elt.name << " " << elt.length << std::endl;
+     }
+   * @endcode
+   *
+   * @param blocksize   The number of elements obtained from the server at once, 0 means RAA_LIST_BLOCK.
+   */
+  Range elements(int blocksize = 0) { return Range(this, blocksize > 0 ? blocksize : RAA_LIST_BLOCK); }
+
+  /**
+   * @brief Iterators over the elements of the list with default block size, see elements().
+   */
+  const_iterator begin() { return elements().begin(); }
+  const_iterator end() { return const_iterator(); }
+
   /**
    * @brief Gives the number of elements (often sequences) in the list.
+   *
+   * The count is computed locally if the list was materialized.
    */
   int getCount();
 
@@ -86,16 +202,45 @@ public:
 
   /**
    * @brief   Adds an element identified by its database rank to the list.
+   *
+   * The local copy of a materialized list is updated too.
    */
   void addElement(int rank);
 
   /**
    * @brief   Removes an element identified by its database rank from the list.
+   *
+   * The local copy of a materialized list is updated too.
    */
   void removeElement(int rank);
 
+  /**
+   * @brief   Adds several elements identified by their database ranks to the list.
+   *
+   * Commands are pipelined to the server, RAA_BIT_WINDOW at a time, so that the time needed does not
+   * grow with the network round trip time multiplied by the number of elements.
+   * The local copy of a materialized list is updated too.
+   *
+   * @throw string if the server could not be reached. Some elements may have been added, and the list
+   * is no longer materialized.
+   */
+  void addElements(const std::vector<int>& ranks);
+
+  /**
+   * @brief   Removes several elements identified by their database ranks from the list.
+   *
+   * Commands are pipelined to the server as with addElements().
+   * The local copy of a materialized list is updated too.
+   *
+   * @throw string if the server could not be reached. Some elements may have been removed, and the list
+   * is no longer materialized.
+   */
+  void removeElements(const std::vector<int>& ranks);
+
   /**
    * @brief   Tests whether an element identified by its database rank belongs to the list.
+   *
+   * No exchange with the server occurs if the list was materialized.
    */
   bool isInList(int rank);
 
@@ -104,6 +249,38 @@ public:
    */
   void zeroList();
 
+  /**
+   * @brief   Downloads the description of all list elements, by columns.
+   *
+   * Elements are obtained from the server by blocks, the next block being requested before
+   * the current one is appended to the columns.
+   *
+   * @param blocksize   The number of elements obtained from the server at once, 0 means RAA_LIST_BLOCK.
+   * @return  The ranks, names, lengths, annotation offsets and database files of all list elements.
+   * @throw string if the list content cannot be obtained from the server.
+   */
+  RaaListColumns fetchColumns(int blocksize = 0);
+
+  /**
+   * @brief   Downloads the list content into a local set of database ranks.
+   *
+   * The list elements are obtained from the server by blocks of RAA_LIST_BLOCK ranks. Afterwards, getCount()
+   * and isInList() don't query the server any more, and the returned set can be combined with those of other
+   * materialized lists. The set uses one bit per database rank of the list kind (e.g., about 60 MB
+   * for a sequence list of a database with 500 million sequences). Changes to the list made by addElement(),
+   * removeElement() and zeroList() are reflected in the local copy; other changes require calling
+   * materialize() again.
+   *
+   * @return  The local set of the list elements, valid until the list is deleted or materialized again.
+   * @throw string if the list content cannot be obtained from the server.
+   */
+  const RaaBitset& materialize();
+
+  /**
+   * @brief   Tells whether the list content is available locally, see materialize().
+   */
+  bool isMaterialized() const { return bits != nullptr; }
+
   /**
    * @brief Gives the rank of the list.
    */
@@ -4,14 +4,15 @@
 
 #include "RaaSpeciesTree.h"
 #include <string>
+#include <vector>
 using namespace std;
 using namespace bpp;
 
 string RaaSpeciesTree::getName(int rank)
 {
-  if (rank >= 2 && rank <= max_sp && sp_tree[rank] != NULL)
+  if (present(rank))
   {
-    string name(sp_tree[rank]->name);
+    string name(RAA_SP_NAME(sp_tree, rank));
     return name;
   }
   else
@@ -24,18 +25,16 @@ string RaaSpeciesTree::getName(int rank)
 
 int RaaSpeciesTree::parent(int rank)
 {
-  if (!(rank > 2 && rank <= max_sp && sp_tree[rank] != NULL))
+  if (!(rank > 2 && present(rank)))
     return 0;
-  while (sp_tree[rank]->parent == NULL)
-    rank = sp_tree[rank]->syno->rank;
-  return sp_tree[rank]->parent->rank;
+  return sp_tree->parent[raa_sp_major(sp_tree, rank)];
 }
 
 
 int RaaSpeciesTree::getTid(int rank)
 {
-  if (rank >= 2 && rank <= max_sp && sp_tree[rank] != NULL)
-    return sp_tree[rank]->parent->tid;
+  if (present(rank))
+    return sp_tree->tid[rank];
   else
     return 0;
 }
@@ -54,18 +53,41 @@ int RaaSpeciesTree::findNode(const string& taxon, bool allowsynonym)
 {
   if (taxon == string("ROOT"))
     return 2;
-  int num = raa_iknum(raa_data, (char*)taxon.c_str(), raa_spec);
+  int num = raa_sp_find(sp_tree, taxon.c_str());
   if (num != 0 && !allowsynonym)
-    while (sp_tree[num]->parent == NULL)
-      num = sp_tree[num]->syno->rank;
+    num = raa_sp_major(sp_tree, num);
   return num;
 }
 
 
+vector<int> RaaSpeciesTree::findNodes(const vector<string>& taxa, bool allowsynonym)
+{
+  vector<int> ranks;
+  ranks.reserve(taxa.size());
+  for (const string& taxon : taxa)
+  {
+    ranks.push_back(findNode(taxon, allowsynonym));
+  }
+  return ranks;
+}
+
+
+vector<int> RaaSpeciesTree::matchNodes(const string& pattern, int maxcount)
+{
+  int* ranks;
+  int count = raa_sp_match(sp_tree, pattern.c_str(), maxcount, &ranks);
+  if (count < 0)
+    return vector<int>();
+  vector<int> retval(ranks, ranks + count);
+  free(ranks);
+  return retval;
+}
+
+
 int RaaSpeciesTree::count(int rank)
 {
-  if (rank >= 2 && rank <= max_sp && sp_tree[rank] != NULL)
-    return sp_tree[rank]->count;
+  if (present(rank))
+    return sp_tree->count[rank];
   else
     return 0;
 }
@@ -73,10 +95,9 @@ int RaaSpeciesTree::count(int rank)
 
 string RaaSpeciesTree::label(int rank)
 {
-  char* p;
-  if (rank > 2 && rank <= max_sp && sp_tree[rank] != NULL && (p = sp_tree[rank]->libel) != NULL)
+  if (rank > 2 && present(rank) && sp_tree->libel[rank] != 0)
   {
-    string retval(p);
+    string retval(sp_tree->strings + sp_tree->libel[rank]);
     return retval;
   }
   else
@@ -89,8 +110,8 @@ string RaaSpeciesTree::label(int rank)
 
 int RaaSpeciesTree::firstChild(int rank)
 {
-  if (rank >= 2 && rank <= max_sp && sp_tree[rank] != NULL)
-    return sp_tree[rank]->list_desc->value->rank;
+  if (present(rank))
+    return sp_tree->first_child[rank];
   else
     return 0;
 }
@@ -98,47 +119,108 @@ int RaaSpeciesTree::firstChild(int rank)
 
 int RaaSpeciesTree::nextChild(int rank, int child)
 {
-  if (!(rank >= 2 && rank <= max_sp && child > 2 && child <= max_sp && sp_tree[rank] != NULL &&
-      sp_tree[child] != NULL))
+  if (!(present(rank) && child > 2 && present(child) && sp_tree->parent[child] == rank))
+    return 0;
+  return sp_tree->next_sibling[child];
+}
+
+
+bool RaaSpeciesTree::isChild(int parent, int child)
+{
+  if (child == parent)
+    return true;
+  if (!present(parent) || (child = placed(child)) == 0)
+    return false;
+  return sp_tree->preorder[parent] != 0 && isAncestor(parent, child);
+}
+
+
+int RaaSpeciesTree::placed(int rank)
+{
+  if (!present(rank))
     return 0;
-  struct raa_pair* pair = sp_tree[rank]->list_desc;
-  while (pair != NULL && pair->value->rank != child)
+  rank = raa_sp_major(sp_tree, rank);
+  return sp_tree->preorder[rank] != 0 ? rank : 0;
+}
+
+
+int RaaSpeciesTree::lowestCommonAncestor(int rank1, int rank2)
+{
+  rank1 = placed(rank1);
+  rank2 = placed(rank2);
+  if (rank1 == 0 || rank2 == 0)
+    return 0;
+  if (isAncestor(rank1, rank2))
+    return rank1;
+  if (isAncestor(rank2, rank1))
+    return rank2;
+  if (jumps.empty())
   {
-    pair = pair->next;
+    // binary lifting table, built at first use: its last level sends every taxon to the root
+    jumps.push_back(vector<int>(sp_tree->parent, sp_tree->parent + sp_tree->max_sp + 1));
+    for (int& r : jumps[0])
+    {
+      if (r == 0)
+        r = 2;
+    }
+    bool done = false;
+    while (!done)
+    {
+      const vector<int>& last = jumps.back();
+      vector<int> next(last.size());
+      done = true;
+      for (size_t r = 0; r < last.size(); r++)
+      {
+        next[r] = last[last[r]];
+        if (next[r] != 2)
+          done = false;
+      }
+      jumps.push_back(next);
+    }
   }
-  return pair == NULL || pair->next == NULL ? 0 : pair->next->value->rank;
+  for (size_t k = jumps.size(); k-- > 0;)
+  {
+    if (!isAncestor(jumps[k][rank1], rank2))
+      rank1 = jumps[k][rank1];
+  }
+  return jumps[0][rank1];
 }
 
 
-bool RaaSpeciesTree::isChild(int parent, int child)
+int RaaSpeciesTree::lowestCommonAncestor(const vector<int>& ranks)
 {
-  while (child != parent)
+  // the common ancestor of a set of taxa is that of its first and last taxa in preorder
+  int first = 0, last = 0;
+  for (int rank : ranks)
   {
-    child = this->parent(child);
-    if (child == 0)
-      return false;
+    if ((rank = placed(rank)) == 0)
+      continue;
+    if (first == 0 || sp_tree->preorder[rank] < sp_tree->preorder[first])
+      first = rank;
+    if (last == 0 || sp_tree->preorder[rank] > sp_tree->preorder[last])
+      last = rank;
   }
-  return true;
+  return first == 0 ? 0 : lowestCommonAncestor(first, last);
 }
 
 
 int RaaSpeciesTree::nextSynonym(int rank)
 {
-  if (!(rank >= 2 && rank <= max_sp && sp_tree[rank] != NULL))
+  if (!present(rank))
     return 0;
-  struct raa_node* mynode =  sp_tree[rank]->syno;
-  if (mynode == NULL)
-    return 0;
-  else
-    return mynode->rank;
+  return sp_tree->syno[rank];
 }
 
 
 int RaaSpeciesTree::getMajor(int rank)
 {
-  if (!(rank >= 2 && rank <= max_sp && sp_tree[rank] != NULL))
+  if (!present(rank))
     return 0;
-  while (sp_tree[rank]->parent == NULL)
-    rank = sp_tree[rank]->syno->rank;
-  return rank;
+  return raa_sp_major(sp_tree, rank);
+}
+
+
+bool RaaSpeciesTree::save(const string& path)
+{
+  return raa_save_taxonomy(raa_data, path.c_str()) == 0;
 }
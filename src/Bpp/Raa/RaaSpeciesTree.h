@@ -10,6 +10,7 @@ extern "C" {
 }
 
 #include <string>
+#include <vector>
 
 namespace bpp
 {
@@ -37,6 +38,32 @@ public:
    */
   int findNode(const std::string& taxon, bool allowsynonym = false);
 
+  /**
+   * @brief Returns the database ranks of several taxa identified by their names.
+   *
+   * Names are searched in the species tree held in memory, without any network exchange.
+   *
+   * @param  taxa    A vector of taxon names. Case is not significant.
+   * @param allowsynonym  If true, the returned ranks will give synonyms' ranks rather than the ranks of their
+   * major taxa.
+   * @return A vector of the database ranks of these taxa, with 0 for names that match no taxon in tree.
+   */
+  std::vector<int> findNodes(const std::vector<std::string>& taxa, bool allowsynonym = false);
+
+  /**
+   * @brief Returns the database ranks of all taxa whose name matches a pattern.
+   *
+   * Names are searched in the species tree held in memory, without any network exchange.
+   * Synonymous taxa are returned when their own name matches the pattern.
+   *
+   * @param  pattern  A pattern-matching string using @ as wildcard (example: Homo\@ for all names
+   * beginning with Homo, \@sapiens\@ for all names containing sapiens). Without @, it matches only this name.
+   * Case is not significant.
+   * @param  maxcount  If > 0, at most maxcount ranks are returned.
+   * @return A vector of the database ranks of matching taxa, in alphabetical order of their names.
+   */
+  std::vector<int> matchNodes(const std::string& pattern, int maxcount = 0);
+
   /**
    * @brief Returns the database rank of a taxon identified by a TID.
    *
@@ -113,6 +140,29 @@ public:
    */
   bool isChild(int parent, int child);
 
+  /**
+   * @brief Returns the lowest common ancestor of two taxa in the species tree.
+   *
+   * Synonymous taxa are replaced by their major taxon.
+   *
+   * @param  rank1  The database rank of a taxon.
+   * @param  rank2  The database rank of another taxon.
+   * @return The database rank of the lowest taxon having both taxa below it (it can be one of them),
+   * or 0 if any of these taxa does not exist in tree.
+   */
+  int lowestCommonAncestor(int rank1, int rank2);
+
+  /**
+   * @brief Returns the lowest common ancestor of a set of taxa in the species tree.
+   *
+   * Synonymous taxa are replaced by their major taxon; ranks of taxa absent from the tree are ignored.
+   *
+   * @param  ranks  A vector of database ranks of taxa.
+   * @return The database rank of the lowest taxon having all these taxa below it, or 0 if none of these
+   * taxa exists in tree.
+   */
+  int lowestCommonAncestor(const std::vector<int>& ranks);
+
   /**
    * @brief Allows to loop around all synonymous taxa of a given taxon.
    *
@@ -132,12 +182,33 @@ public:
    */
   int getMajor(int rank);
 
+  /**
+   * @brief Saves the species tree to a file that RAA::mapSpeciesTree() can later map in memory.
+   *
+   * The file records the database and its release, and is replaced only once fully written.
+   *
+   * @param  path  The name of the file to write.
+   * @return true iff the file was written.
+   */
+  bool save(const std::string& path);
+
 private:
+  bool present(int rank) const { return RAA_SP_PRESENT(sp_tree, rank); }
+
+  int placed(int rank);
+
+  bool isAncestor(int ancestor, int rank) const
+  {
+    return sp_tree->preorder[ancestor] <= sp_tree->preorder[rank] &&
+           sp_tree->preorder[rank] <= sp_tree->preorder_end[ancestor];
+  }
+
   raa_db_access* raa_data;
-  raa_node** sp_tree;
+  raa_sp_tree* sp_tree;
   int* tid_to_rank;
   int max_tid;
-  int max_sp;
+  std::vector< std::vector<int> > jumps; // jumps[k][rank] is the 2^k-th ancestor of rank
+
 };
 } // namespace bpp.
 
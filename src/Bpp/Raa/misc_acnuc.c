@@ -11,6 +11,7 @@
 #elif defined(unix) || defined(__APPLE__)
 #define unixlike
 #include <termios.h>
+#include <pthread.h>
 #endif
 
 
@@ -29,6 +30,7 @@ void* mycalloc(int nbr, size_t taille);
 char complementer_base(char nucl);
 void complementer_seq(char* deb_ch, int l);
 char init_codon_to_aa(char* codon, int gc);
+size_t translate_nucleotides(const char* nt, size_t n, int gc, char* out);
 int notrail2(char* chaine, int len);
 int prepch(char* chaine, char** posmot);
 int compch(char* cible, int lcible, char** posmot, int nbrmots);
@@ -368,6 +370,86 @@ int calc_codon_number(char* codon)
 }
 
 
+/*
+   tables de traduction precalculees pour chaque code genetique:
+   une base est codee de 0 a 3 (ACG et T ou U, majuscules ou minuscules) ou 4 si autre caractere,
+   un codon est l'indice 25 * b1 + 5 * b2 + b3 de 0 a 124, les codons avec une base 4 donnent X
+ */
+#define TOTTRIPLETS 125
+static unsigned char base_index[256];
+static char aa_table[TOTCODES][TOTTRIPLETS];
+static char init_aa_table[TOTCODES][TOTTRIPLETS];
+/* the tables are built once, by the first thread that needs them */
+#if defined(unixlike)
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+#elif defined(WIN32)
+static volatile LONG tables_state = 0; /* 0: not built, 1: being built, 2: ready */
+#else
+static int tables_ready = 0;
+#endif
+
+
+static void init_translation_tables(void)
+{
+  static char nucleotides[] = "AaCcGgTtUu";
+  static int nucnum[5] = {0, 1, 2, 3, 3};
+  int i, gc, b1, b2, b3, num, aa;
+
+  for (i = 0; i < 256; i++)
+    base_index[i] = 4;
+  for (i = 0; nucleotides[i] != 0; i++)
+    base_index[(unsigned char)nucleotides[i]] = nucnum[i / 2];
+  for (gc = 0; gc < TOTCODES; gc++)
+  {
+    for (i = 0; i < TOTTRIPLETS; i++)
+    {
+      b1 = i / 25; b2 = (i / 5) % 5; b3 = i % 5;
+      if (b1 == 4 || b2 == 4 || b3 == 4)
+      {
+        aa_table[gc][i] = init_aa_table[gc][i] = 'X';
+        continue;
+      }
+      num = 16 * b1 + 4 * b2 + b3;
+      aa_table[gc][i] = aminoacids[genetic_code[gc].code[num] - 1];
+      aa = genetic_code[gc].codon_init[num];
+      init_aa_table[gc][i] = (aa == 0 ? aa_table[gc][i] : aminoacids[aa - 1]);
+    }
+  }
+}
+
+
+static void translation_tables(void)
+/* builds the translation tables if not done yet, safely from any thread */
+{
+#if defined(unixlike)
+  pthread_once(&tables_once, init_translation_tables);
+#elif defined(WIN32)
+  if (tables_state == 2)
+    return;
+  if (InterlockedCompareExchange(&tables_state, 1, 0) == 0)
+  {
+    init_translation_tables();
+    InterlockedExchange(&tables_state, 2);
+  }
+  else
+  {
+    while (tables_state != 2)
+      Sleep(0);
+  }
+#else
+  if (!tables_ready)
+  {
+    init_translation_tables();
+    tables_ready = 1;
+  }
+#endif
+}
+
+
+#define triplet_index(p) (25 * base_index[(unsigned char)(p)[0]] + 5 * base_index[(unsigned char)(p)[1]] + \
+    base_index[(unsigned char)(p)[2]])
+
+
 char codaa(char* codon, int code)
 /*
    amino acid translation:
@@ -376,14 +458,46 @@ char codaa(char* codon, int code)
    return value	the amino acid as 1 character
  */
 {
-  struct genetic_code_libel* pdata;
-  int num;
-
-  num = calc_codon_number(codon);
+  translation_tables();
   if (code < 0 || code >= totcodes)
     code = 0; /*use regular code if unknown number */
-  pdata = &genetic_code[code]; /* ici ecriture plus compacte mal compilee sur PC*/
-  return aminoacids[ pdata->code[num] - 1 ];
+  return aa_table[code][triplet_index(codon)];
+}
+
+
+size_t translate_nucleotides(const char* nt, size_t n, int gc, char* out)
+/*
+   bulk amino acid translation:
+   nt	n nucleotides translated from their first base
+   gc	the genetic code to be used
+   out	receives the n / 3 amino acids, without trailing null; out can be equal to nt
+   return value	the number of amino acids written to out
+   The loop is branch-free and processes 4 codons per iteration, all reads of an
+   iteration preceding its writes so that translation in place is possible.
+ */
+{
+  const char* table;
+  size_t naa = n / 3, pos = 0;
+  int i0, i1, i2, i3;
+
+  translation_tables();
+  if (gc < 0 || gc >= totcodes)
+    gc = 0; /*use regular code if unknown number */
+  table = aa_table[gc];
+  for ( ; pos + 4 <= naa; pos += 4, nt += 12)
+  {
+    i0 = triplet_index(nt);
+    i1 = triplet_index(nt + 3);
+    i2 = triplet_index(nt + 6);
+    i3 = triplet_index(nt + 9);
+    out[pos] = table[i0];
+    out[pos + 1] = table[i1];
+    out[pos + 2] = table[i2];
+    out[pos + 3] = table[i3];
+  }
+  for ( ; pos < naa; pos++, nt += 3)
+    out[pos] = table[triplet_index(nt)];
+  return naa;
 }
 
 
@@ -549,21 +663,12 @@ void complementer_seq(char* deb_ch, int l)
 
 char init_codon_to_aa(char* codon, int gc)
 {
-  int num, aa;
-  struct genetic_code_libel* pdata;
-
-  num = calc_codon_number(codon);
-  if (num >= 64)
-    return 'X';
+  translation_tables();
 /* use regular code if unknown number */
   if (gc < 0 || gc >= totcodes)
     gc = 0;
-  pdata = &genetic_code[gc];
-  aa = pdata->codon_init[num];
-/* if not listed in expected init codons */
-  if (aa == 0)
-    aa = pdata->code[num];
-  return aminoacids[aa - 1];
+/* init_aa_table holds the regular translation of codons not listed in expected init codons */
+  return init_aa_table[gc][triplet_index(codon)];
 }
 
 
@@ -626,11 +731,14 @@ int compch(char* cible, int lcible, char** posmot, int nbrmots)
    posmot: tableau fabrique par prepch
    nbrmots: valeur rendue par prepch
    valeur rendue: 1 ssi template present dans cible, 0 si absent
+   reentrante: la copie de cible est locale
  */
   int num = 0, l, total;
   char* pos;
-  static char vcible[151];
+  char vcible[151];
 
+  if (lcible > 150)
+    lcible = 150;
   pos = cible + lcible - 1;
   while (pos >= cible && *pos == ' ')
     pos--;
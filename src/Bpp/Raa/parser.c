@@ -71,6 +71,7 @@ void parse(char* chaine, Reponse* rep)
       if (*chaine == 0)
         break;
       chaine++;
+      continue; /* the closing " can end the reply */
     }
     if (*chaine == '&')
     {
@@ -130,3 +131,139 @@ char* unprotect_quotes(char* name)
   }
   return name;
 }
+
+
+/** parseur sans allocation : decoupe la ligne sur place en champs cle=valeur **/
+static char* quoted_end(char* chaine)
+/* chaine pointe sur une " ouvrante ; rend l'adresse de la " fermante ou du 0 final,
+   en ignorant les \" sauf si en fin de partie entre " " */
+{
+  do
+  {
+    chaine++;
+    if (*chaine == 0)
+      break;
+  }
+  while (*chaine != '"' || ( *(chaine - 1) == '\\' && *(chaine + 1) != '&' && *(chaine + 1) != 0) );
+  return chaine;
+}
+
+
+static void add_field(Fields* f, char* arg)
+/* arg: "cle=valeur" termine par 0 ; la valeur est debarrassee sur place de ses " " encadrantes
+   et ses \" internes sont decodes en " */
+{
+  char* p, * q;
+  size_t l;
+
+  if (f->count >= MAX_FIELDS)
+    return;
+  p = strchr(arg, '=');
+  if (p == NULL)
+    return;
+  *(p++) = 0;
+  f->key[f->count] = arg;
+  f->value[f->count] = p;
+  f->count++;
+  if (*p == '"')
+  {
+    p++;
+    f->value[f->count - 1] = p;
+    l = strlen(p);
+    if (l > 0 && p[l - 1] == '"')
+      p[l - 1] = 0;
+  }
+  if ((q = strstr(p, "\\\"")) != NULL)
+  {
+    for (p = q; *q != 0; q++)
+    {
+      if (*q == '\\' && *(q + 1) == '"')
+        continue;
+      *(p++) = *q;
+    }
+    *p = 0;
+  }
+}
+
+
+int parse_fields(char* line, Fields* f)
+/* decoupe sur place line (modifiee) en champs separes par &, hors des parties entre " " ;
+   rend le nombre de champs */
+{
+  char* ori, * p;
+  int end;
+
+  f->count = 0;
+  ori = p = line;
+  while (TRUE)
+  {
+    if (*p == '"')
+    {
+      p = quoted_end(p);
+      if (*p != 0)
+        p++;
+      continue;
+    }
+    if (*p == '&' || *p == 0)
+    {
+      end = (*p == 0);
+      *p = 0;
+      add_field(f, ori);
+      if (end)
+        break;
+      ori = p + 1;
+    }
+    p++;
+  }
+  return f->count;
+}
+
+
+char* field_str(Fields* f, const char* key)
+/* valeur d'un champ, dans la ligne analysee, ou NULL si absent */
+{
+  int num;
+
+  for (num = 0; num < f->count; num++)
+  {
+    if (strcmp(f->key[num], key) == 0)
+      return f->value[num];
+  }
+  return NULL;
+}
+
+
+int field_int(Fields* f, const char* key, int defval)
+/* valeur entiere d'un champ, ou defval si absent ; les valeurs > INT_MAX sont lues comme par %u */
+{
+  char* p = field_str(f, key);
+  unsigned v = 0;
+  int neg;
+
+  if (p == NULL)
+    return defval;
+  while (*p == ' ')
+    p++;
+  neg = (*p == '-');
+  if (neg || *p == '+')
+    p++;
+  while (*p >= '0' && *p <= '9')
+    v = 10 * v + (*(p++) - '0');
+  return (int)(neg ? 0u - v : v);
+}
+
+
+raa_long field_long(Fields* f, const char* key, raa_long defval)
+/* valeur entiere 64 bits d'un champ, ou defval si absent */
+{
+  char* p = field_str(f, key);
+  raa_long v = 0;
+
+  if (p == NULL)
+    return defval;
+  while (*p == ' ')
+    p++;
+  while (*p >= '0' && *p <= '9')
+    v = 10 * v + (*(p++) - '0');
+  return v;
+}
@@ -5,6 +5,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "RAA_acnuc.h"
+
 typedef struct ThisReponse
 {
   char** arg; /* je stocke les arguments */
@@ -16,3 +18,18 @@ extern void clear_reponse(Reponse* rep);
 void ajout_reponse(Reponse* rep, char* pile, int len);
 extern void parse(char* chaine, Reponse* rep);
 extern char* val(Reponse* Mono, char* argument);
+
+
+/* in-place parsing of a reply into key=value fields, without memory allocation */
+#define MAX_FIELDS 50
+typedef struct
+{
+  int count; /* number of fields */
+  char* key[MAX_FIELDS]; /* null-terminated keys and values, in the parsed line */
+  char* value[MAX_FIELDS];
+} Fields;
+
+extern int parse_fields(char* line, Fields* f);
+extern char* field_str(Fields* f, const char* key);
+extern int field_int(Fields* f, const char* key, int defval);
+extern raa_long field_long(Fields* f, const char* key, raa_long defval);
@@ -4,40 +4,37 @@
 
 /* functions to handle zlib-compressed data read from socket
  */
+#include "RAA_acnuc.h"
+
 #include <zlib.h>
 #include <unistd.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
+#include <errno.h>
 #ifdef WIN32
 #include <winsock.h>
 #endif
 
 
 /* included functions */
-void* prepare_sock_gz_r(FILE* sockr);
-int z_getc(void* v);
-char* z_gets(void* v, char* line, size_t len);
-char* z_read_sock(void* v);
-int close_sock_gz_r(void* v);
+void* raa_zlib_new(raa_socket fd, const char* pending, size_t lpending);
+int raa_zlib_inflate(void* v, char* out, size_t room);
+long raa_zlib_finish(void* v);
+void raa_zlib_end(void* v, char* out);
 
 
-#define ZBSIZE 100000
+#define ZBSIZE RAA_ZBSIZE
 typedef struct
 {
   z_stream stream;
-  char z_buffer[ZBSIZE]; /* compressed input buffer */
-  char text_buffer[4 * ZBSIZE]; /* decompressed buffer */
-  char* pos, * endbuf;
-#ifdef WIN32
-  SOCKET fd;
-#else
-  int fd;
-#endif
+  char* z_buffer; /* compressed input buffer, of ZBSIZE bytes or more */
+  int ended; /* TRUE when the end of the compressed stream was met */
+  raa_socket fd;
 } sock_gz_r;
 
 
-void* prepare_sock_gz_r(FILE* sockr)
+void* raa_zlib_new(raa_socket fd, const char* pending, size_t lpending)
+/* prepares to inflate data read from socket fd;
+   pending: lpending bytes of compressed data already read from the socket
+ */
 {
   int err;
   sock_gz_r* big;
@@ -45,117 +42,100 @@ void* prepare_sock_gz_r(FILE* sockr)
   big = (sock_gz_r*)malloc(sizeof(sock_gz_r));
   if (big == NULL)
     return NULL;
-  big->stream.next_in = Z_NULL;
-  big->stream.avail_in = 0;
+  big->z_buffer = (char*)malloc(lpending > ZBSIZE ? lpending : ZBSIZE);
+  if (big->z_buffer == NULL)
+  {
+    free(big);
+    return NULL;
+  }
+  memcpy(big->z_buffer, pending, lpending);
+  big->stream.next_in = (Bytef*)big->z_buffer;
+  big->stream.avail_in = (uInt)lpending;
   big->stream.avail_out = 0;
   big->stream.zalloc = Z_NULL;
   big->stream.zfree = Z_NULL;
   big->stream.opaque = NULL;
-  big->pos = big->text_buffer;
-  big->endbuf = big->pos;
-#ifdef WIN32
-  big->fd = (SOCKET)sockr;
-#else
-  big->fd = fileno(sockr);
-#endif
+  big->ended = FALSE;
+  big->fd = fd;
   err = inflateInit(&big->stream);
-  return err == Z_OK ? (void*)big : NULL;
+  if (err != Z_OK)
+  {
+    free(big->z_buffer);
+    free(big);
+    return NULL;
+  }
+  return big;
 }
 
 
-int z_getc(void* v)
+int raa_zlib_inflate(void* v, char* out, size_t room)
+/* inflates at most room bytes into out, reading the socket as needed;
+   returns the number of bytes produced, 0 at end of compressed stream, -1 if error
+ */
 {
-  int q;
   sock_gz_r* big = (sock_gz_r*)v;
   z_streamp zs;
+  int q, lu;
 
-  if (big->pos < big->endbuf)
-  {
-    return *(big->pos++);
-  }
+  if (big->ended)
+    return 0;
   zs = &(big->stream);
-  zs->next_out = (Bytef*)big->text_buffer;
-  zs->avail_out = sizeof(big->text_buffer);
-  big->pos = (char*)zs->next_out;
-  do
+  zs->next_out = (Bytef*)out;
+  zs->avail_out = (uInt)room;
+  while (TRUE)
   {
+    q = inflate(zs, Z_NO_FLUSH);
+    if (q == Z_STREAM_END)
+    {
+      big->ended = TRUE;
+      break;
+    }
+    if (q != Z_OK && q != Z_BUF_ERROR)
+      return -1;
+    if ( (char*)zs->next_out != out)
+      break;
+    /* read the socket only when inflate cannot progress without more input */
     if (zs->avail_in == 0)
     {
-      int lu;
 #ifdef WIN32
-      lu = recv( big->fd, big->z_buffer, ZBSIZE, 0 );
+      lu = recv( (SOCKET)big->fd, big->z_buffer, ZBSIZE, 0 );
 #else
-      lu = read( big->fd, big->z_buffer, ZBSIZE );
+      do
+        lu = read( big->fd, big->z_buffer, ZBSIZE );
+      while (lu == -1 && errno == EINTR);
 #endif
-      if (lu == -1)
-        return EOF;
+      if (lu <= 0)
+        return -1;
       zs->next_in = (Bytef*)big->z_buffer;
       zs->avail_in = lu;
     }
-    q = inflate(zs, Z_NO_FLUSH);
-    if (q == Z_STREAM_END)
-      break;
-    if (q != Z_OK)
-    {
-      break;
-    }
   }
-  while ( (char*)zs->next_out == big->pos);
-  big->endbuf = (char*)zs->next_out;
-  if (big->pos < big->endbuf)
-    return *(big->pos++);
-  else
-    return EOF;
+  return (int)((char*)zs->next_out - out);
 }
 
 
-char* z_gets(void* v, char* line, size_t len)
-{
-  int c;
-  char* p;
-
-  p = line;
-  while (len > 1)
-  {
-    c = z_getc( v );
-    if (c == EOF)
-    {
-      if (p == line)
-        return NULL;
-      break;
-    }
-    *(p++) = c;
-    if (c == '\n')
-      break;
-    len--;
-  }
-  *p = 0;
-  return line;
-}
-
-
-char* z_read_sock(void* v)
+long raa_zlib_finish(void* v)
+/* reads and discards the rest of the compressed stream; returns the number of raw bytes read from socket
+   after the end of the compressed stream, -1 if the stream could not be read to its end
+ */
 {
-  static char line[500];
-  char* p;
-  int l;
+  sock_gz_r* big = (sock_gz_r*)v;
+  char discard[4096];
 
-  p = z_gets(v, line, sizeof(line));
-  if (p == NULL)
-    return NULL;
-  l = strlen(line);
-  if (l > 0 && line[l - 1] == '\n')
-    line[l - 1] = 0;
-  return line;
+  while (raa_zlib_inflate(v, discard, sizeof(discard)) > 0)
+    ;
+  return big->ended ? (long)big->stream.avail_in : -1;
 }
 
 
-int close_sock_gz_r(void* v)
+void raa_zlib_end(void* v, char* out)
+/* copies to out, unless NULL, the raw bytes counted by raa_zlib_finish, and frees the inflater */
 {
   sock_gz_r* big = (sock_gz_r*)v;
-  int val;
 
-  val = inflateEnd(&(big->stream));
+  if (out != NULL && big->ended)
+    memcpy(out, big->stream.next_in, big->stream.avail_in);
+  inflateEnd(&(big->stream));
+  free(big->z_buffer);
   free(big);
-  return val;
 }